@@ -0,0 +1,54 @@
+#include "adapt.h"
+
+#include <math.h>
+
+void
+adapt_init(Adaptive* adapt, const u64 min_interval_us, const u64 max_interval_us) {
+    *adapt = (Adaptive){
+        .min_interval_us = min_interval_us,
+        .max_interval_us = max_interval_us,
+        .interval_us = min_interval_us,
+    };
+}
+
+void
+adapt_reply(Adaptive* adapt, const f64 rtt) {
+    if (!adapt->primed) {
+        adapt->srtt = rtt;
+        adapt->rttvar = rtt / 2.0;
+        adapt->primed = true;
+        return;
+    }
+
+    const f64 deviation = fabs(rtt - adapt->srtt);
+    const bool anomaly = deviation > ADAPT_ANOMALY_DEVIATIONS * adapt->rttvar;
+
+    adapt->rttvar = 0.75 * adapt->rttvar + 0.25 * deviation;
+    adapt->srtt = 0.875 * adapt->srtt + 0.125 * rtt;
+
+    if (anomaly) {
+        adapt_loss(adapt);
+        return;
+    }
+
+    if (++adapt->stable < ADAPT_STABLE_PROBES) return;
+    adapt->stable = 0;
+    adapt->interval_us *= 2;
+    if (adapt->interval_us > adapt->max_interval_us) adapt->interval_us = adapt->max_interval_us;
+}
+
+void
+adapt_loss(Adaptive* adapt) {
+    adapt->stable = 0;
+    adapt->interval_us = adapt->min_interval_us;
+}
+
+u64
+adapt_rto(const Adaptive* adapt, const u64 max_us) {
+    if (!adapt->primed) return max_us;
+
+    const u64 rto_us = (adapt->srtt + ADAPT_RTO_DEVIATIONS * adapt->rttvar) * 1000.0;
+    if (rto_us < ADAPT_MIN_RTO_US) return ADAPT_MIN_RTO_US;
+    if (rto_us > max_us) return max_us;
+    return rto_us;
+}
@@ -0,0 +1,38 @@
+#pragma once
+
+#include "types.h"
+
+#include <stdbool.h>
+
+#define ADAPT_STABLE_PROBES 10
+#define ADAPT_ANOMALY_DEVIATIONS 4.0
+#define ADAPT_RTO_DEVIATIONS 4.0
+#define ADAPT_MIN_RTO_US (10 * 1000)
+
+// Probe interval that follows the target's stability. Smoothed rtt and deviation are kept as in
+// rfc 6298; a loss, an error or a reply more than ADAPT_ANOMALY_DEVIATIONS deviations off the
+// smoothed rtt drops the interval back to the minimum, and every ADAPT_STABLE_PROBES quiet
+// replies in a row double it up to the maximum.
+typedef struct {
+    f64 srtt;
+    f64 rttvar;
+    bool primed;
+    u32 stable;
+    u64 min_interval_us;
+    u64 max_interval_us;
+    u64 interval_us;
+} Adaptive;
+
+void
+adapt_init(Adaptive* adapt, const u64 min_interval_us, const u64 max_interval_us);
+
+void
+adapt_reply(Adaptive* adapt, const f64 rtt);
+
+void
+adapt_loss(Adaptive* adapt);
+
+// srtt + ADAPT_RTO_DEVIATIONS * rttvar, between ADAPT_MIN_RTO_US and max_us; max_us until the
+// first reply
+u64
+adapt_rto(const Adaptive* adapt, const u64 max_us);
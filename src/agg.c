@@ -0,0 +1,168 @@
+#include "hist.h"
+#include "push.h"
+#include "types.h"
+
+#include <arpa/inet.h>
+#include <errno.h>
+#include <poll.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#define MAX_SOURCES 4096
+
+typedef struct {
+    u32 sources[MAX_SOURCES];
+    u32 source_count;
+    u64 transmitted;
+    u64 received;
+    u64 duplicate;
+    Histogram hist;
+} Totals;
+
+static const char* progname = NULL;
+static Totals totals = { 0 };
+
+static void
+usage(void) {
+    dprintf(STDERR_FILENO, "usage: %s <listen> [interval]\n\n", progname);
+    dprintf(STDERR_FILENO, "  %-20s%s\n", "<listen>", "host:port for udp, or a unix socket path");
+    dprintf(STDERR_FILENO, "  %-20s%s\n", "[interval]", "seconds between reports, default 10");
+}
+
+static void
+fail(const char* what) {
+    const char* err = strerror(errno);
+    dprintf(STDERR_FILENO, "%s: %s: %s\n", progname, what, err);
+    exit(EXIT_FAILURE);
+}
+
+static void
+add_source(const u32 source) {
+    for (u32 i = 0; i < totals.source_count; i++) {
+        if (totals.sources[i] == source) return;
+    }
+    if (totals.source_count < MAX_SOURCES) totals.sources[totals.source_count++] = source;
+}
+
+static void
+merge(const u8* buffer, const u64 size) {
+    const PushHeader* header = (const PushHeader*)buffer;
+    const PushBucket* buckets = (const PushBucket*)(header + 1);
+
+    const u32 count = ntohl(header->bucket_count);
+    if (count > HIST_BUCKETS || size < sizeof(*header) + count * sizeof(PushBucket)) return;
+
+    add_source(ntohl(header->source));
+    totals.transmitted += ntohl(header->transmitted);
+    totals.received += ntohl(header->received);
+    totals.duplicate += ntohl(header->duplicate);
+
+    for (u32 i = 0; i < count; i++) {
+        const u32 index = ntohl(buckets[i].index);
+        if (index >= HIST_BUCKETS) continue;
+
+        const u32 delta = ntohl(buckets[i].count);
+        totals.hist.buckets[index] += delta;
+        totals.hist.count += delta;
+    }
+}
+
+static i32
+format_report(char* buffer, const u64 size) {
+    const u64 sent = totals.transmitted;
+    const u64 lost = sent > totals.received ? sent - totals.received : 0;
+    const f64 loss = sent > 0 ? lost * 100.0 / sent : 0.0;
+
+    return snprintf(
+        buffer,
+        size,
+        "%u sources, %lu transmitted, %lu received, %.1f%% packet loss, "
+        "rtt p50/p90/p99 = %.3f/%.3f/%.3f ms\n",
+        totals.source_count,
+        totals.transmitted,
+        totals.received,
+        loss,
+        hist_percentile(&totals.hist, 50.0) / 1000.0,
+        hist_percentile(&totals.hist, 90.0) / 1000.0,
+        hist_percentile(&totals.hist, 99.0) / 1000.0
+    );
+}
+
+static i32
+open_listener(const char* listen_on) {
+    PushAddr addr;
+    if (!push_resolve(listen_on, &addr)) {
+        dprintf(STDERR_FILENO, "%s: invalid address: '%s'\n", progname, listen_on);
+        exit(EXIT_FAILURE);
+    }
+
+    const i32 fd = socket(addr.addr.ss_family, SOCK_DGRAM, 0);
+    if (fd < 0) fail("socket");
+
+    if (addr.addr.ss_family == AF_UNIX) unlink(((struct sockaddr_un*)&addr.addr)->sun_path);
+    if (bind(fd, (struct sockaddr*)&addr.addr, addr.addr_len) != 0) fail(listen_on);
+
+    return fd;
+}
+
+int
+main(int argc, const char* const* argv) {
+    progname = argc > 0 ? argv[0] : "ft_ping_agg";
+
+    if (argc < 2 || argc > 3) {
+        usage();
+        exit(EXIT_FAILURE);
+    }
+
+    const i32 interval = argc > 2 ? atoi(argv[2]) : 10;
+    if (interval <= 0) {
+        dprintf(STDERR_FILENO, "%s: invalid interval value: '%s'\n", progname, argv[2]);
+        exit(EXIT_FAILURE);
+    }
+
+    const i32 fd = open_listener(argv[1]);
+
+    struct timeval last;
+    gettimeofday(&last, NULL);
+
+    // single reader: every merge happens on this thread, so the totals need no locking
+    while (true) {
+        struct pollfd pfd = { .fd = fd, .events = POLLIN };
+        if (poll(&pfd, 1, 1000) < 0 && errno != EINTR) fail("poll");
+
+        if (pfd.revents & POLLIN) {
+            u8 buffer[PUSH_MAX_SIZE];
+            struct sockaddr_storage from;
+            socklen_t from_len = sizeof(from);
+
+            const ssize_t bytes =
+                recvfrom(fd, buffer, sizeof(buffer), 0, (struct sockaddr*)&from, &from_len);
+            const PushHeader* header = (const PushHeader*)buffer;
+
+            if (bytes >= (ssize_t)sizeof(*header) && ntohl(header->magic) == PUSH_MAGIC) {
+                if (ntohl(header->kind) == Push_Query) {
+                    char report[256];
+                    const i32 len = format_report(report, sizeof(report));
+                    sendto(fd, report, len, 0, (struct sockaddr*)&from, from_len);
+                } else {
+                    merge(buffer, bytes);
+                }
+            }
+        }
+
+        struct timeval now;
+        gettimeofday(&now, NULL);
+        if (now.tv_sec - last.tv_sec >= interval) {
+            char report[256];
+            format_report(report, sizeof(report));
+            printf("%s", report);
+            fflush(stdout);
+            last = now;
+        }
+    }
+}
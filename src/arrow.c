@@ -0,0 +1,322 @@
+#include "arrow.h"
+#include "flatbuf.h"
+
+#include <fcntl.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#define ARROW_MAGIC "ARROW1"
+#define ARROW_ALIGN 8
+#define ARROW_CONTINUATION 0xffffffffu
+#define ARROW_FIELDS 6
+#define ARROW_BUFFERS 13
+
+typedef enum {
+    Metadata_V5 = 4,
+} MetadataVersion;
+
+typedef enum {
+    MessageHeader_Schema = 1,
+    MessageHeader_RecordBatch = 3,
+} MessageHeader;
+
+typedef enum {
+    Type_Int = 2,
+    Type_Utf8 = 5,
+    Type_Timestamp = 10,
+} Type;
+
+typedef enum {
+    TimeUnit_Microsecond = 2,
+} TimeUnit;
+
+typedef struct {
+    i64 a;
+    i64 b;
+} ArrowPair;
+
+typedef struct {
+    const void* data;
+    u64 size;
+} ArrowBuffer;
+
+static u64
+padded(const u64 size) {
+    return (size + ARROW_ALIGN - 1) & ~(u64)(ARROW_ALIGN - 1);
+}
+
+static bool
+write_all(ArrowWriter* writer, const void* data, const u64 size) {
+    const u8* ptr = data;
+    u64 left = size;
+
+    while (left > 0) {
+        const ssize_t res = write(writer->fd, ptr, left);
+        if (res <= 0) return false;
+        ptr += res;
+        left -= res;
+    }
+
+    writer->offset += size;
+    return true;
+}
+
+static bool
+write_padding(ArrowWriter* writer) {
+    static const u8 zeros[ARROW_ALIGN] = { 0 };
+    return write_all(writer, zeros, padded(writer->offset) - writer->offset);
+}
+
+static FbRef
+int_type(FlatBuf* fb, const i32 bits, const bool is_signed) {
+    fb_start_table(fb);
+    fb_add_i32(fb, 0, bits);
+    fb_add_u8(fb, 1, is_signed);
+    return fb_end_table(fb);
+}
+
+static FbRef
+field(FlatBuf* fb, const char* name, const bool nullable, const u8 type_type, const FbRef type) {
+    const FbRef name_ref = fb_string(fb, name);
+    fb_start_vector(fb, sizeof(u32), 0, sizeof(u32));
+    const FbRef children = fb_end_vector(fb, 0);
+
+    fb_start_table(fb);
+    fb_add_ref(fb, 0, name_ref);
+    fb_add_u8(fb, 1, nullable);
+    fb_add_u8(fb, 2, type_type);
+    fb_add_ref(fb, 3, type);
+    fb_add_ref(fb, 5, children);
+    return fb_end_table(fb);
+}
+
+static FbRef
+schema(FlatBuf* fb) {
+    FbRef fields[ARROW_FIELDS];
+
+    const FbRef tz = fb_string(fb, "UTC");
+    fb_start_table(fb);
+    fb_add_i16(fb, 0, TimeUnit_Microsecond);
+    fb_add_ref(fb, 1, tz);
+    fields[0] = field(fb, "timestamp", false, Type_Timestamp, fb_end_table(fb));
+
+    fb_start_table(fb);
+    fields[1] = field(fb, "target", false, Type_Utf8, fb_end_table(fb));
+
+    fields[2] = field(fb, "seq", false, Type_Int, int_type(fb, 16, false));
+    fields[3] = field(fb, "rtt_ns", true, Type_Int, int_type(fb, 64, true));
+    fields[4] = field(fb, "ttl", true, Type_Int, int_type(fb, 8, false));
+    fields[5] = field(fb, "type", true, Type_Int, int_type(fb, 8, false));
+
+    fb_start_vector(fb, sizeof(u32), ARROW_FIELDS, sizeof(u32));
+    for (u32 i = ARROW_FIELDS; i-- > 0;) fb_push_ref(fb, fields[i]);
+    const FbRef fields_ref = fb_end_vector(fb, ARROW_FIELDS);
+
+    fb_start_table(fb);
+    fb_add_ref(fb, 1, fields_ref);
+    return fb_end_table(fb);
+}
+
+static FbRef
+message(FlatBuf* fb, const u8 header_type, const FbRef header, const i64 body_size) {
+    fb_start_table(fb);
+    fb_add_i64(fb, 3, body_size);
+    fb_add_ref(fb, 2, header);
+    fb_add_i16(fb, 0, Metadata_V5);
+    fb_add_u8(fb, 1, header_type);
+    return fb_end_table(fb);
+}
+
+// encapsulated message: continuation marker, metadata length, flatbuffer padded to 8 bytes
+static bool
+write_message(ArrowWriter* writer, FlatBuf* fb, const FbRef root, ArrowBlock* block) {
+    const u8* data = fb_finish(fb, root);
+    const u32 meta_size = padded(fb->size + 8) - 8;
+    const u32 prefix[2] = { ARROW_CONTINUATION, meta_size };
+
+    block->offset = writer->offset;
+    block->meta_size = meta_size + sizeof(prefix);
+
+    return write_all(writer, prefix, sizeof(prefix)) && write_all(writer, data, fb->size)
+        && write_padding(writer);
+}
+
+static bool
+push_block(ArrowWriter* writer, const ArrowBlock* block) {
+    if (writer->block_count == writer->block_capacity) {
+        const u32 capacity = writer->block_capacity ? writer->block_capacity * 2 : 16;
+        ArrowBlock* blocks = realloc(writer->blocks, capacity * sizeof(ArrowBlock));
+        if (blocks == NULL) return false;
+
+        writer->blocks = blocks;
+        writer->block_capacity = capacity;
+    }
+
+    writer->blocks[writer->block_count++] = *block;
+    return true;
+}
+
+static bool
+flush_batch(ArrowWriter* writer) {
+    const u32 rows = writer->rows;
+    if (rows == 0) return true;
+
+    const ArrowBuffer validity = {
+        .data = writer->validity,
+        .size = writer->null_count > 0 ? (rows + 7) / 8 : 0,
+    };
+    const ArrowBuffer buffers[ARROW_BUFFERS] = {
+        { 0 },
+        { writer->ts, rows * sizeof(i64) },
+        { 0 },
+        { writer->target_offsets, (rows + 1) * sizeof(i32) },
+        { writer->target_data, writer->target_offsets[rows] },
+        { 0 },
+        { writer->seq, rows * sizeof(u16) },
+        validity,
+        { writer->rtt, rows * sizeof(i64) },
+        validity,
+        { writer->ttl, rows },
+        validity,
+        { writer->type, rows },
+    };
+
+    FlatBuf fb;
+    if (!fb_init(&fb)) return false;
+
+    u64 body_size = 0;
+    fb_start_vector(&fb, sizeof(ArrowPair), ARROW_BUFFERS, ARROW_ALIGN);
+    for (u32 i = 0; i < ARROW_BUFFERS; i++) body_size += padded(buffers[i].size);
+    u64 end = body_size;
+    for (u32 i = ARROW_BUFFERS; i-- > 0;) {
+        end -= padded(buffers[i].size);
+        const ArrowPair buffer = { .a = end, .b = buffers[i].size };
+        fb_push_struct(&fb, &buffer, sizeof(buffer));
+    }
+    const FbRef buffers_ref = fb_end_vector(&fb, ARROW_BUFFERS);
+
+    fb_start_vector(&fb, sizeof(ArrowPair), ARROW_FIELDS, ARROW_ALIGN);
+    for (u32 i = ARROW_FIELDS; i-- > 0;) {
+        const ArrowPair node = { .a = rows, .b = i >= 3 ? writer->null_count : 0 };
+        fb_push_struct(&fb, &node, sizeof(node));
+    }
+    const FbRef nodes_ref = fb_end_vector(&fb, ARROW_FIELDS);
+
+    fb_start_table(&fb);
+    fb_add_i64(&fb, 0, rows);
+    fb_add_ref(&fb, 1, nodes_ref);
+    fb_add_ref(&fb, 2, buffers_ref);
+    const FbRef batch = fb_end_table(&fb);
+
+    ArrowBlock block = { .body_size = body_size };
+    const FbRef root = message(&fb, MessageHeader_RecordBatch, batch, body_size);
+    bool ok = write_message(writer, &fb, root, &block);
+    fb_free(&fb);
+
+    for (u32 i = 0; ok && i < ARROW_BUFFERS; i++) {
+        ok = write_all(writer, buffers[i].data, buffers[i].size) && write_padding(writer);
+    }
+    ok = ok && push_block(writer, &block);
+
+    writer->rows = 0;
+    writer->null_count = 0;
+    memset(writer->validity, 0, sizeof(writer->validity));
+
+    return ok;
+}
+
+bool
+arrow_open(ArrowWriter* writer, const char* path) {
+    memset(writer, 0, sizeof(*writer));
+    writer->fd = open(path, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (writer->fd < 0) return false;
+
+    static const u8 magic[ARROW_ALIGN] = ARROW_MAGIC;
+    if (!write_all(writer, magic, sizeof(magic))) return false;
+
+    FlatBuf fb;
+    if (!fb_init(&fb)) return false;
+
+    ArrowBlock block;
+    const FbRef root = message(&fb, MessageHeader_Schema, schema(&fb), 0);
+    const bool ok = write_message(writer, &fb, root, &block);
+    fb_free(&fb);
+
+    return ok;
+}
+
+bool
+arrow_append(ArrowWriter* writer, const ArrowRow* row) {
+    const u32 len = strlen(row->target);
+    if (len > ARROW_TARGET_BYTES) return false;
+    if (writer->target_offsets[writer->rows] + len > ARROW_TARGET_BYTES) {
+        if (!flush_batch(writer)) return false;
+    }
+
+    const u32 i = writer->rows;
+    const i32 offset = writer->target_offsets[i];
+    memcpy(writer->target_data + offset, row->target, len);
+    writer->target_offsets[i + 1] = offset + len;
+
+    writer->ts[i] = row->ts_us;
+    writer->seq[i] = row->seq;
+    if (row->has_reply) {
+        writer->rtt[i] = row->rtt_ns;
+        writer->ttl[i] = row->ttl;
+        writer->type[i] = row->type;
+        writer->validity[i / 8] |= 1 << (i % 8);
+    } else {
+        writer->rtt[i] = 0;
+        writer->ttl[i] = 0;
+        writer->type[i] = 0;
+        writer->null_count++;
+    }
+
+    writer->rows++;
+    if (writer->rows == ARROW_BATCH_ROWS) return flush_batch(writer);
+    return true;
+}
+
+bool
+arrow_close(ArrowWriter* writer) {
+    bool ok = flush_batch(writer);
+
+    const u32 eos[2] = { ARROW_CONTINUATION, 0 };
+    ok = ok && write_all(writer, eos, sizeof(eos));
+
+    FlatBuf fb;
+    ok = ok && fb_init(&fb);
+    if (ok) {
+        const FbRef schema_ref = schema(&fb);
+
+        fb_start_vector(&fb, sizeof(ArrowBlock), 0, ARROW_ALIGN);
+        const FbRef dictionaries = fb_end_vector(&fb, 0);
+
+        fb_start_vector(&fb, sizeof(ArrowBlock), writer->block_count, ARROW_ALIGN);
+        for (u32 i = writer->block_count; i-- > 0;) {
+            fb_push_struct(&fb, &writer->blocks[i], sizeof(ArrowBlock));
+        }
+        const FbRef batches = fb_end_vector(&fb, writer->block_count);
+
+        fb_start_table(&fb);
+        fb_add_ref(&fb, 1, schema_ref);
+        fb_add_ref(&fb, 2, dictionaries);
+        fb_add_ref(&fb, 3, batches);
+        fb_add_i16(&fb, 0, Metadata_V5);
+        const u8* footer = fb_finish(&fb, fb_end_table(&fb));
+        const i32 footer_size = fb.size;
+
+        ok = write_all(writer, footer, footer_size)
+            && write_all(writer, &footer_size, sizeof(footer_size))
+            && write_all(writer, ARROW_MAGIC, strlen(ARROW_MAGIC));
+        fb_free(&fb);
+    }
+
+    free(writer->blocks);
+    writer->blocks = NULL;
+    close(writer->fd);
+    writer->fd = -1;
+
+    return ok;
+}
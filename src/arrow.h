@@ -0,0 +1,55 @@
+#pragma once
+
+#include "types.h"
+
+#include <stdbool.h>
+
+#define ARROW_BATCH_ROWS 1024
+#define ARROW_TARGET_BYTES (64 * 1024)
+
+typedef struct {
+    u64 ts_us;
+    const char* target;
+    u16 seq;
+    bool has_reply;
+    i64 rtt_ns;
+    u8 ttl;
+    u8 type;
+} ArrowRow;
+
+typedef struct {
+    i64 offset;
+    i32 meta_size;
+    i32 pad;
+    i64 body_size;
+} ArrowBlock;
+
+// Writes probe results as an Arrow IPC file. Rows are buffered column by column and written
+// as one record batch every ARROW_BATCH_ROWS rows. rtt_ns, ttl and type are null for probes
+// that got no reply.
+typedef struct {
+    i32 fd;
+    u64 offset;
+    u32 rows;
+    u32 null_count;
+    i64 ts[ARROW_BATCH_ROWS];
+    i32 target_offsets[ARROW_BATCH_ROWS + 1];
+    char target_data[ARROW_TARGET_BYTES];
+    u16 seq[ARROW_BATCH_ROWS];
+    i64 rtt[ARROW_BATCH_ROWS];
+    u8 ttl[ARROW_BATCH_ROWS];
+    u8 type[ARROW_BATCH_ROWS];
+    u8 validity[ARROW_BATCH_ROWS / 8];
+    ArrowBlock* blocks;
+    u32 block_count;
+    u32 block_capacity;
+} ArrowWriter;
+
+bool
+arrow_open(ArrowWriter* writer, const char* path);
+
+bool
+arrow_append(ArrowWriter* writer, const ArrowRow* row);
+
+bool
+arrow_close(ArrowWriter* writer);
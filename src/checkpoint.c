@@ -0,0 +1,39 @@
+#include "checkpoint.h"
+
+#include <fcntl.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+Checkpoint*
+checkpoint_open(const char* path, struct in_addr addr) {
+    const i32 fd = open(path, O_RDWR | O_CREAT, 0644);
+    if (fd < 0) return NULL;
+
+    if (ftruncate(fd, sizeof(Checkpoint)) != 0) {
+        close(fd);
+        return NULL;
+    }
+
+    Checkpoint* checkpoint =
+        mmap(NULL, sizeof(Checkpoint), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    if (checkpoint == MAP_FAILED) return NULL;
+
+    const bool valid = checkpoint->magic == CHECKPOINT_MAGIC
+                    && checkpoint->size == sizeof(Checkpoint)
+                    && checkpoint->addr.s_addr == addr.s_addr;
+    if (!valid) {
+        memset(checkpoint, 0, sizeof(Checkpoint));
+        checkpoint->magic = CHECKPOINT_MAGIC;
+        checkpoint->size = sizeof(Checkpoint);
+        checkpoint->addr = addr;
+    }
+
+    return checkpoint;
+}
+
+void
+checkpoint_sync(Checkpoint* checkpoint) {
+    msync(checkpoint, sizeof(Checkpoint), MS_ASYNC);
+}
@@ -0,0 +1,29 @@
+#pragma once
+
+#include "ping.h"
+#include "types.h"
+
+#include <stdbool.h>
+
+#define CHECKPOINT_MAGIC 0x43505446u // "FTPC"
+#define CHECKPOINT_SYNC_PROBES 30
+
+// Lifetime state of a run, kept in a shared mapping of the checkpoint file so it survives
+// restarts. The size field doubles as a layout version: a build with a different Stats or
+// sequence layout starts over instead of misreading the file.
+typedef struct {
+    u32 magic;
+    u32 size;
+    struct in_addr addr;
+    bool resumable;
+    u16 seq;
+    u64 phase_us;
+    u8 bits_duplicate[DUP_TABLE_SIZE];
+    Stats stats;
+} Checkpoint;
+
+Checkpoint*
+checkpoint_open(const char* path, struct in_addr addr);
+
+void
+checkpoint_sync(Checkpoint* checkpoint);
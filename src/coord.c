@@ -0,0 +1,127 @@
+#include "coord.h"
+
+#include <arpa/inet.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <unistd.h>
+
+typedef struct {
+    u32 magic;
+    char id[COORD_MAX_ID];
+} Heartbeat;
+
+static u64
+now_us(void) {
+    struct timeval now;
+    gettimeofday(&now, NULL);
+    return now.tv_usec + (u64)now.tv_sec * 1000000;
+}
+
+static u64
+hash(const char* member, const char* target) {
+    u64 h = 0xcbf29ce484222325ull;
+    for (const char* c = member; *c; c++) h = (h ^ (u8)*c) * 0x100000001b3ull;
+    h = (h ^ 0xff) * 0x100000001b3ull;
+    for (const char* c = target; *c; c++) h = (h ^ (u8)*c) * 0x100000001b3ull;
+
+    // fnv alone mixes the last bytes poorly, finish with splitmix64
+    h ^= h >> 30;
+    h *= 0xbf58476d1ce4e5b9ull;
+    h ^= h >> 27;
+    h *= 0x94d049bb133111ebull;
+    h ^= h >> 31;
+    return h;
+}
+
+// "self,peer,peer": each entry is host:port, the first one is bound by this instance
+bool
+coord_open(Coord* coord, const char* peers, const u64 round_us) {
+    memset(coord, 0, sizeof(*coord));
+    coord->expiry_us = COORD_EXPIRY_ROUNDS * round_us;
+
+    const char* ptr = peers;
+    while (*ptr != 0 && coord->peer_count < COORD_MAX_MEMBERS) {
+        const char* end = strchr(ptr, ',');
+        const u64 len = end != NULL ? (u64)(end - ptr) : strlen(ptr);
+        if (len == 0 || len >= COORD_MAX_ID) return false;
+
+        char entry[COORD_MAX_ID];
+        memcpy(entry, ptr, len);
+        entry[len] = 0;
+
+        if (coord->peer_count == 0) memcpy(coord->self, entry, len + 1);
+        if (!push_resolve(entry, &coord->peers[coord->peer_count++])) return false;
+
+        ptr += end != NULL ? len + 1 : len;
+    }
+    if (coord->peer_count == 0) return false;
+
+    const PushAddr* self = &coord->peers[0];
+    coord->fd = socket(self->addr.ss_family, SOCK_DGRAM, 0);
+    if (coord->fd < 0) return false;
+
+    return bind(coord->fd, (const struct sockaddr*)&self->addr, self->addr_len) == 0;
+}
+
+static void
+seen(Coord* coord, const char* id, const u64 now) {
+    for (u32 i = 0; i < coord->member_count; i++) {
+        if (strcmp(coord->members[i].id, id) == 0) {
+            coord->members[i].last_seen = now;
+            return;
+        }
+    }
+
+    if (coord->member_count == COORD_MAX_MEMBERS) return;
+    Member* member = &coord->members[coord->member_count++];
+    memcpy(member->id, id, COORD_MAX_ID);
+    member->last_seen = now;
+}
+
+static void
+exchange(Coord* coord, const u64 now) {
+    Heartbeat beat = { .magic = htonl(COORD_MAGIC) };
+    memcpy(beat.id, coord->self, COORD_MAX_ID);
+    for (u32 i = 1; i < coord->peer_count; i++) {
+        const PushAddr* peer = &coord->peers[i];
+        const struct sockaddr* addr = (const struct sockaddr*)&peer->addr;
+        sendto(coord->fd, &beat, sizeof(beat), 0, addr, peer->addr_len);
+    }
+
+    while (recv(coord->fd, &beat, sizeof(beat), MSG_DONTWAIT) == sizeof(beat)) {
+        if (ntohl(beat.magic) != COORD_MAGIC) continue;
+        beat.id[COORD_MAX_ID - 1] = 0;
+        seen(coord, beat.id, now);
+    }
+
+    seen(coord, coord->self, now);
+
+    for (u32 i = 0; i < coord->member_count;) {
+        if (now - coord->members[i].last_seen > coord->expiry_us) {
+            coord->members[i] = coord->members[--coord->member_count];
+        } else {
+            i++;
+        }
+    }
+}
+
+// called once per interval; the first round only announces, so a starting instance does not
+// probe everything before it has heard from the rest of the fleet
+bool
+coord_owns(Coord* coord, const char* target) {
+    exchange(coord, now_us());
+    if (coord->rounds++ == 0) return false;
+
+    const char* owner = NULL;
+    u64 best = 0;
+    for (u32 i = 0; i < coord->member_count; i++) {
+        const u64 h = hash(coord->members[i].id, target);
+        if (owner == NULL || h > best || (h == best && strcmp(coord->members[i].id, owner) < 0)) {
+            owner = coord->members[i].id;
+            best = h;
+        }
+    }
+
+    return owner != NULL && strcmp(owner, coord->self) == 0;
+}
@@ -0,0 +1,38 @@
+#pragma once
+
+#include "push.h"
+#include "types.h"
+
+#include <stdbool.h>
+
+#define COORD_MAGIC 0x4a505446u // "FTPJ"
+#define COORD_MAX_MEMBERS 64
+#define COORD_MAX_ID 64
+#define COORD_EXPIRY_ROUNDS 3
+
+typedef struct {
+    char id[COORD_MAX_ID];
+    u64 last_seen;
+} Member;
+
+// Fleet membership for probers sharing targets. Every instance announces itself to all peers
+// once per probe round, and a peer that stays silent for COORD_EXPIRY_ROUNDS of the longest
+// round (a reply wait or an interval, whichever is longer) leaves the membership.
+// A target belongs to the live member with the highest rendezvous hash, so a join or a leave
+// only moves the targets won or lost by that one member.
+typedef struct {
+    i32 fd;
+    char self[COORD_MAX_ID];
+    PushAddr peers[COORD_MAX_MEMBERS];
+    u32 peer_count;
+    Member members[COORD_MAX_MEMBERS];
+    u32 member_count;
+    u32 rounds;
+    u64 expiry_us;
+} Coord;
+
+bool
+coord_open(Coord* coord, const char* peers, const u64 round_us);
+
+bool
+coord_owns(Coord* coord, const char* target);
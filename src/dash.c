@@ -0,0 +1,144 @@
+#include "dash.h"
+#include "utils.h"
+
+#include <math.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/time.h>
+#include <unistd.h>
+
+static const char* const spark_levels[] = { "▁", "▂", "▃", "▄", "▅", "▆", "▇", "█" };
+
+void
+dash_sample(Dashboard* dash, const f64 rtt) {
+    dash->history[dash->history_head] = rtt;
+    dash->history_head = (dash->history_head + 1) % DASH_SPARK_WIDTH;
+    if (dash->history_len < DASH_SPARK_WIDTH) dash->history_len++;
+    dash->last_rtt = rtt;
+}
+
+static void
+render_sparkline(const Dashboard* dash, char* out, const u64 size) {
+    f64 min = INFINITY;
+    f64 max = 0.0;
+    for (u32 i = 0; i < dash->history_len; i++) {
+        const f64 rtt = dash->history[i];
+        if (isnan(rtt)) continue;
+        if (rtt < min) min = rtt;
+        if (rtt > max) max = rtt;
+    }
+
+    u64 len = 0;
+    const u32 first =
+        (dash->history_head + DASH_SPARK_WIDTH - dash->history_len) % DASH_SPARK_WIDTH;
+    for (u32 i = 0; i < dash->history_len && len + 4 < size; i++) {
+        const f64 rtt = dash->history[(first + i) % DASH_SPARK_WIDTH];
+
+        const char* cell = "x";
+        if (!isnan(rtt)) {
+            const f64 span = max - min;
+            const u32 level = span > 0.0 ? (rtt - min) / span * 7.0 + 0.5 : 0;
+            cell = spark_levels[level];
+        }
+
+        const u64 cell_len = strlen(cell);
+        memcpy(out + len, cell, cell_len);
+        len += cell_len;
+    }
+    out[len] = 0;
+}
+
+static void
+render_frame(
+    const Dashboard* dash,
+    const PingData* ping,
+    const Stats* stats,
+    char (*frame)[DASH_LINE_SIZE]
+) {
+    const u32 lost = stats->pkt_transmitted - stats->pkt_received;
+    const f64 loss = stats->pkt_transmitted > 0 ? lost * 100.0 / stats->pkt_transmitted : 0.0;
+
+    snprintf(frame[0], DASH_LINE_SIZE, "%s (%s)", ping->dst, ping->ip);
+    snprintf(
+        frame[1],
+        DASH_LINE_SIZE,
+        "sent %u  recv %u  loss %.1f%%",
+        stats->pkt_transmitted,
+        stats->pkt_received,
+        loss
+    );
+
+    if (dash->history_len == 0) {
+        snprintf(frame[2], DASH_LINE_SIZE, "last -");
+    } else if (isnan(dash->last_rtt)) {
+        snprintf(frame[2], DASH_LINE_SIZE, "last no reply");
+    } else {
+        snprintf(frame[2], DASH_LINE_SIZE, "last %.3f ms", dash->last_rtt);
+    }
+    const u64 len = strlen(frame[2]);
+    snprintf(
+        frame[2] + len,
+        DASH_LINE_SIZE - len,
+        "  p50 %.3f  p90 %.3f  p99 %.3f ms",
+        hist_percentile(&stats->hist, 50.0) / 1000.0,
+        hist_percentile(&stats->hist, 90.0) / 1000.0,
+        hist_percentile(&stats->hist, 99.0) / 1000.0
+    );
+
+    render_sparkline(dash, frame[3], DASH_LINE_SIZE);
+}
+
+// display column of a byte offset, counting utf-8 lead bytes only
+static u32
+column(const char* line, const u64 offset) {
+    u32 col = 0;
+    for (u64 i = 0; i < offset; i++) {
+        if (((u8)line[i] & 0xc0) != 0x80) col++;
+    }
+    return col;
+}
+
+void
+dash_render(Dashboard* dash, const PingData* ping, const Stats* stats, const bool force) {
+    struct timeval now;
+    gettimeofday(&now, NULL);
+    const u64 now_us = to_us(now);
+    if (!force && dash->drawn && now_us - dash->last_frame_us < DASH_FRAME_US) return;
+    dash->last_frame_us = now_us;
+
+    char frame[DASH_LINES][DASH_LINE_SIZE];
+    render_frame(dash, ping, stats, frame);
+
+    char out[DASH_LINES * (DASH_LINE_SIZE + 32)];
+    u64 len = 0;
+
+    for (u32 i = 0; i < DASH_LINES; i++) {
+        const char* prev = dash->drawn ? dash->frame[i] : "";
+
+        u64 diff = 0;
+        while (frame[i][diff] != 0 && frame[i][diff] == prev[diff]) diff++;
+        if (dash->drawn && frame[i][diff] == 0 && prev[diff] == 0) continue;
+        while (diff > 0 && ((u8)frame[i][diff] & 0xc0) == 0x80) diff--;
+
+        // the cursor rests on the line below the frame between redraws
+        const u32 up = DASH_LINES - i;
+        const u32 col = column(frame[i], diff);
+        if (dash->drawn) len += snprintf(out + len, sizeof(out) - len, "\x1b[%uA\r", up);
+        if (col > 0) len += snprintf(out + len, sizeof(out) - len, "\x1b[%uC", col);
+        len += snprintf(out + len, sizeof(out) - len, "%s\x1b[K", frame[i] + diff);
+        if (dash->drawn) {
+            len += snprintf(out + len, sizeof(out) - len, "\x1b[%uB\r", up);
+        } else {
+            len += snprintf(out + len, sizeof(out) - len, "\n");
+        }
+    }
+
+    memcpy(dash->frame, frame, sizeof(frame));
+    dash->drawn = true;
+
+    if (len > 0) {
+        fflush(stdout);
+        const ssize_t res = write(STDOUT_FILENO, out, len);
+        (void)res;
+    }
+}
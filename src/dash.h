@@ -0,0 +1,30 @@
+#pragma once
+
+#include "ping.h"
+#include "types.h"
+
+#include <stdbool.h>
+
+#define DASH_LINES 4
+#define DASH_LINE_SIZE 256
+#define DASH_SPARK_WIDTH 48
+#define DASH_FRAME_US (250 * 1000)
+
+// Live view that replaces the per-reply lines. Frames are rendered from a snapshot of Stats at
+// most every DASH_FRAME_US, and only the part of each line that differs from the previous
+// frame is rewritten, so a redraw is usually a few bytes in a single write.
+typedef struct {
+    char frame[DASH_LINES][DASH_LINE_SIZE];
+    f64 history[DASH_SPARK_WIDTH];
+    u32 history_len;
+    u32 history_head;
+    f64 last_rtt;
+    u64 last_frame_us;
+    bool drawn;
+} Dashboard;
+
+void
+dash_sample(Dashboard* dash, const f64 rtt);
+
+void
+dash_render(Dashboard* dash, const PingData* ping, const Stats* stats, const bool force);
@@ -0,0 +1,165 @@
+#include "flatbuf.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#define FB_INITIAL_CAPACITY 1024
+
+bool
+fb_init(FlatBuf* fb) {
+    *fb = (FlatBuf){ .capacity = FB_INITIAL_CAPACITY, .minalign = 1 };
+    fb->data = calloc(fb->capacity, 1);
+    return fb->data != NULL;
+}
+
+void
+fb_free(FlatBuf* fb) {
+    free(fb->data);
+    fb->data = NULL;
+}
+
+static void
+reserve(FlatBuf* fb, const u32 len) {
+    if (fb->size + len <= fb->capacity) return;
+
+    u32 capacity = fb->capacity;
+    while (fb->size + len > capacity) capacity *= 2;
+
+    u8* data = calloc(capacity, 1);
+    if (data == NULL) abort();
+    memcpy(data + capacity - fb->size, fb->data + fb->capacity - fb->size, fb->size);
+
+    free(fb->data);
+    fb->data = data;
+    fb->capacity = capacity;
+}
+
+static void
+push(FlatBuf* fb, const void* src, const u32 len) {
+    reserve(fb, len);
+    fb->size += len;
+    memcpy(fb->data + fb->capacity - fb->size, src, len);
+}
+
+// pads so that `align` is satisfied once `extra` more bytes are pushed
+static void
+prep(FlatBuf* fb, const u32 align, const u32 extra) {
+    if (align > fb->minalign) fb->minalign = align;
+
+    const u32 pad = (0u - (fb->size + extra)) & (align - 1);
+    reserve(fb, pad);
+    fb->size += pad;
+}
+
+static void
+push_u16(FlatBuf* fb, const u16 value) {
+    push(fb, &value, sizeof(value));
+}
+
+static void
+push_u32(FlatBuf* fb, const u32 value) {
+    push(fb, &value, sizeof(value));
+}
+
+FbRef
+fb_string(FlatBuf* fb, const char* str) {
+    const u32 len = strlen(str);
+
+    prep(fb, 4, len + 1);
+    push(fb, "", 1);
+    push(fb, str, len);
+    push_u32(fb, len);
+
+    return fb->size;
+}
+
+void
+fb_start_vector(FlatBuf* fb, const u32 elem_size, const u32 count, const u32 align) {
+    prep(fb, 4, elem_size * count);
+    prep(fb, align, elem_size * count);
+}
+
+void
+fb_push_ref(FlatBuf* fb, const FbRef ref) {
+    push_u32(fb, fb->size + 4 - ref);
+}
+
+void
+fb_push_struct(FlatBuf* fb, const void* data, const u32 size) {
+    push(fb, data, size);
+}
+
+FbRef
+fb_end_vector(FlatBuf* fb, const u32 count) {
+    push_u32(fb, count);
+    return fb->size;
+}
+
+void
+fb_start_table(FlatBuf* fb) {
+    memset(fb->fields, 0, sizeof(fb->fields));
+    fb->field_count = 0;
+    fb->table_start = fb->size;
+}
+
+static void
+add_field(FlatBuf* fb, const u32 id, const void* value, const u32 size) {
+    prep(fb, size, 0);
+    push(fb, value, size);
+
+    fb->fields[id] = fb->size;
+    if (id + 1 > fb->field_count) fb->field_count = id + 1;
+}
+
+void
+fb_add_u8(FlatBuf* fb, const u32 id, const u8 value) {
+    add_field(fb, id, &value, sizeof(value));
+}
+
+void
+fb_add_i16(FlatBuf* fb, const u32 id, const i16 value) {
+    add_field(fb, id, &value, sizeof(value));
+}
+
+void
+fb_add_i32(FlatBuf* fb, const u32 id, const i32 value) {
+    add_field(fb, id, &value, sizeof(value));
+}
+
+void
+fb_add_i64(FlatBuf* fb, const u32 id, const i64 value) {
+    add_field(fb, id, &value, sizeof(value));
+}
+
+void
+fb_add_ref(FlatBuf* fb, const u32 id, const FbRef ref) {
+    prep(fb, 4, 0);
+    const u32 offset = fb->size + 4 - ref;
+    add_field(fb, id, &offset, sizeof(offset));
+}
+
+FbRef
+fb_end_table(FlatBuf* fb) {
+    prep(fb, 4, 0);
+    push_u32(fb, 0);
+    const u32 table = fb->size;
+
+    for (u32 i = fb->field_count; i-- > 0;) {
+        push_u16(fb, fb->fields[i] != 0 ? table - fb->fields[i] : 0);
+    }
+    push_u16(fb, table - fb->table_start);
+    push_u16(fb, (2 + fb->field_count) * sizeof(u16));
+
+    // the table starts with the signed distance back to its vtable
+    const i32 vtable = fb->size - table;
+    memcpy(fb->data + fb->capacity - table, &vtable, sizeof(vtable));
+
+    return table;
+}
+
+const u8*
+fb_finish(FlatBuf* fb, const FbRef root) {
+    prep(fb, fb->minalign, 4);
+    fb_push_ref(fb, root);
+    return fb->data + fb->capacity - fb->size;
+}
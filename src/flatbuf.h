@@ -0,0 +1,68 @@
+#pragma once
+
+#include "types.h"
+
+#include <stdbool.h>
+
+#define FB_MAX_FIELDS 8
+
+typedef u32 FbRef;
+
+// Minimal back-to-front flatbuffer builder, just enough to write Arrow IPC metadata. Data
+// grows down from the end of the buffer and references are distances from that end, so they
+// stay valid when the buffer is reallocated. Children must be finished before their parent
+// table is started, as with the reference builder.
+typedef struct {
+    u8* data;
+    u32 capacity;
+    u32 size;
+    u32 minalign;
+    u32 table_start;
+    u32 field_count;
+    u32 fields[FB_MAX_FIELDS];
+} FlatBuf;
+
+bool
+fb_init(FlatBuf* fb);
+
+void
+fb_free(FlatBuf* fb);
+
+FbRef
+fb_string(FlatBuf* fb, const char* str);
+
+void
+fb_start_vector(FlatBuf* fb, const u32 elem_size, const u32 count, const u32 align);
+
+void
+fb_push_ref(FlatBuf* fb, const FbRef ref);
+
+void
+fb_push_struct(FlatBuf* fb, const void* data, const u32 size);
+
+FbRef
+fb_end_vector(FlatBuf* fb, const u32 count);
+
+void
+fb_start_table(FlatBuf* fb);
+
+void
+fb_add_u8(FlatBuf* fb, const u32 id, const u8 value);
+
+void
+fb_add_i16(FlatBuf* fb, const u32 id, const i16 value);
+
+void
+fb_add_i32(FlatBuf* fb, const u32 id, const i32 value);
+
+void
+fb_add_i64(FlatBuf* fb, const u32 id, const i64 value);
+
+void
+fb_add_ref(FlatBuf* fb, const u32 id, const FbRef ref);
+
+FbRef
+fb_end_table(FlatBuf* fb);
+
+const u8*
+fb_finish(FlatBuf* fb, const FbRef root);
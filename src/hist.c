@@ -0,0 +1,52 @@
+#include "hist.h"
+
+static u32
+bucket_index(u64 us) {
+    if (us >= (1ull << HIST_MAX_BITS)) us = (1ull << HIST_MAX_BITS) - 1;
+    if (us < HIST_SUB) return us;
+
+    const u32 msb = 63 - __builtin_clzll(us);
+    const u32 shift = msb - HIST_SUB_BITS;
+    return (shift + 1) * HIST_SUB + ((us >> shift) & (HIST_SUB - 1));
+}
+
+static f64
+bucket_midpoint(const u32 index) {
+    const u32 group = index / HIST_SUB;
+    const u64 sub = index % HIST_SUB;
+    if (group == 0) return sub;
+
+    const u64 width = 1ull << (group - 1);
+    const u64 lower = (HIST_SUB + sub) << (group - 1);
+    return lower + (width - 1) / 2.0;
+}
+
+void
+hist_add(Histogram* hist, u64 us) {
+    hist->buckets[bucket_index(us)]++;
+    hist->count++;
+}
+
+void
+hist_merge(Histogram* dst, const Histogram* src) {
+    for (u32 i = 0; i < HIST_BUCKETS; i++) {
+        dst->buckets[i] += src->buckets[i];
+    }
+    dst->count += src->count;
+}
+
+f64
+hist_percentile(const Histogram* hist, const f64 percent) {
+    if (hist->count == 0) return 0.0;
+
+    u64 rank = (u64)(percent / 100.0 * hist->count + 0.5);
+    if (rank == 0) rank = 1;
+
+    u64 seen = 0;
+    for (u32 i = 0; i < HIST_BUCKETS; i++) {
+        seen += hist->buckets[i];
+        if (seen >= rank) return bucket_midpoint(i);
+    }
+
+    return bucket_midpoint(HIST_BUCKETS - 1);
+}
@@ -0,0 +1,25 @@
+#pragma once
+
+#include "types.h"
+
+#define HIST_SUB_BITS 4
+#define HIST_SUB (1 << HIST_SUB_BITS)
+#define HIST_MAX_BITS 32
+#define HIST_BUCKETS (HIST_SUB * (HIST_MAX_BITS - HIST_SUB_BITS + 1))
+
+// Log-linear histogram of microsecond values: 16 linear sub-buckets per power of two, so
+// any value is off by at most ~3% from its bucket midpoint. The layout is fixed, which makes
+// histograms from different sources mergeable by adding buckets.
+typedef struct {
+    u64 count;
+    u32 buckets[HIST_BUCKETS];
+} Histogram;
+
+void
+hist_add(Histogram* hist, u64 us);
+
+void
+hist_merge(Histogram* dst, const Histogram* src);
+
+f64
+hist_percentile(const Histogram* hist, const f64 percent);
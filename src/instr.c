@@ -0,0 +1,42 @@
+#include "instr.h"
+
+#include <stdio.h>
+
+Instr instr = { 0 };
+
+static const char* const stage_names[Stage_Count] = {
+    [Stage_Build] = "build",
+    [Stage_Send] = "send",
+    [Stage_Receive] = "receive+wait",
+    [Stage_Decode] = "decode",
+    [Stage_Resolve] = "resolve",
+    [Stage_Stats] = "stats",
+    [Stage_Output] = "output",
+};
+
+void
+instr_init(void) {
+    instr.start_ticks = instr_now();
+    clock_gettime(CLOCK_MONOTONIC, &instr.start_time);
+}
+
+void
+instr_print(void) {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+
+    const f64 elapsed_ns = (now.tv_sec - instr.start_time.tv_sec) * 1e9
+                         + (now.tv_nsec - instr.start_time.tv_nsec);
+    const u64 ticks = instr_now() - instr.start_ticks;
+    const f64 ns_per_tick = ticks > 0 ? elapsed_ns / ticks : 0.0;
+
+    printf("%-14s%8s%12s%12s\n", "stage", "calls", "avg us", "max us");
+    for (u32 i = 0; i < Stage_Count; i++) {
+        const StageCounter* counter = &instr.stages[i];
+        if (counter->calls == 0) continue;
+
+        const f64 avg = counter->ticks * ns_per_tick / counter->calls / 1000.0;
+        const f64 max = counter->max * ns_per_tick / 1000.0;
+        printf("%-14s%8lu%12.3f%12.3f\n", stage_names[i], counter->calls, avg, max);
+    }
+}
@@ -0,0 +1,67 @@
+#pragma once
+
+#include "types.h"
+
+#include <time.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+
+typedef enum {
+    Stage_Build,
+    Stage_Send,
+    Stage_Receive,
+    Stage_Decode,
+    Stage_Resolve,
+    Stage_Stats,
+    Stage_Output,
+    Stage_Count,
+} Stage;
+
+typedef struct {
+    u64 calls;
+    u64 ticks;
+    u64 max;
+} StageCounter;
+
+// Time spent by ft_ping itself on each stage of the probe path, in timestamp counter ticks.
+// Ticks are converted to nanoseconds at report time against the monotonic clock over the
+// whole run, so no calibration delay is needed at startup.
+typedef struct {
+    StageCounter stages[Stage_Count];
+    u64 start_ticks;
+    struct timespec start_time;
+} Instr;
+
+extern Instr instr;
+
+static inline u64
+instr_now(void) {
+#if defined(__x86_64__) || defined(__i386__)
+    return __rdtsc();
+#else
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000000000ull + ts.tv_nsec;
+#endif
+}
+
+static inline u64
+instr_end(const Stage stage, const u64 begin) {
+    const u64 now = instr_now();
+    const u64 ticks = now - begin;
+
+    StageCounter* counter = &instr.stages[stage];
+    counter->calls++;
+    counter->ticks += ticks;
+    if (ticks > counter->max) counter->max = ticks;
+
+    return now;
+}
+
+void
+instr_init(void);
+
+void
+instr_print(void);
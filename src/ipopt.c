@@ -0,0 +1,155 @@
+#include "ipopt.h"
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/socket.h>
+
+#define IPOPT_TS_NONSTANDARD 0x80000000u
+
+bool
+set_ip_options(const i32 fd, const IpOptKind kind) {
+    u8 opts[MAX_IPOPTLEN] = { 0 };
+    u32 len = 0;
+
+    switch (kind) {
+        case IpOpt_None:
+            return true;
+        case IpOpt_RecordRoute:
+            // leading nop keeps the address slots 4-byte aligned
+            opts[0] = IPOPT_NOP;
+            opts[1 + IPOPT_OPTVAL] = IPOPT_RR;
+            opts[1 + IPOPT_OLEN] = MAX_IPOPTLEN - 1;
+            opts[1 + IPOPT_OFFSET] = IPOPT_MINOFF;
+            len = MAX_IPOPTLEN;
+            break;
+        case IpOpt_TsOnly:
+        case IpOpt_TsAndAddr:
+            opts[IPOPT_OPTVAL] = IPOPT_TS;
+            opts[IPOPT_OLEN] = kind == IpOpt_TsOnly ? 40 : 36;
+            opts[IPOPT_OFFSET] = IPOPT_MINOFF + 1;
+            opts[3] = kind == IpOpt_TsOnly ? IPOPT_TS_TSONLY : IPOPT_TS_TSANDADDR;
+            len = opts[IPOPT_OLEN];
+            break;
+    }
+
+    return setsockopt(fd, IPPROTO_IP, IP_OPTIONS, opts, len) == 0;
+}
+
+static u32
+read_u32(const u8* ptr) {
+    u32 out;
+    memcpy(&out, ptr, sizeof(out));
+    return out;
+}
+
+static void
+parse_rr(const u8* opt, const u32 len, IpOptRoute* out) {
+    const u32 ptr = opt[IPOPT_OFFSET];
+    const u32 end = ptr - 1 < len ? ptr - 1 : len;
+
+    out->kind = IpOpt_RecordRoute;
+    out->count = 0;
+    for (u32 i = IPOPT_MINOFF - 1; i + 4 <= end && out->count < IPOPT_MAX_HOPS; i += 4) {
+        out->addr[out->count++].s_addr = read_u32(opt + i);
+    }
+}
+
+static void
+parse_ts(const u8* opt, const u32 len, IpOptRoute* out) {
+    const u32 ptr = opt[IPOPT_OFFSET];
+    const u32 end = ptr - 1 < len ? ptr - 1 : len;
+    const u8 flags = opt[3] & 0x0f;
+    const u32 stride = flags == IPOPT_TS_TSONLY ? 4 : 8;
+
+    out->kind = flags == IPOPT_TS_TSONLY ? IpOpt_TsOnly : IpOpt_TsAndAddr;
+    out->overflow = opt[3] >> 4;
+    out->count = 0;
+    for (u32 i = IPOPT_MINOFF; i + stride <= end && out->count < IPOPT_MAX_HOPS; i += stride) {
+        if (stride == 8) {
+            out->addr[out->count].s_addr = read_u32(opt + i);
+        }
+        out->ts[out->count++] = ntohl(read_u32(opt + i + stride - 4));
+    }
+}
+
+bool
+parse_ip_options(const struct ip* ip, IpOptRoute* out) {
+    const u8* opt = (const u8*)ip + sizeof(*ip);
+    const u8* end = (const u8*)ip + (ip->ip_hl << 2);
+
+    while (opt < end) {
+        switch (opt[IPOPT_OPTVAL]) {
+            case IPOPT_EOL:
+                return false;
+            case IPOPT_NOP:
+                opt++;
+                continue;
+            default:
+                break;
+        }
+
+        if (opt + 2 > end) return false;
+        const u32 len = opt[IPOPT_OLEN];
+        if (len < 2 || opt + len > end) return false;
+
+        switch (opt[IPOPT_OPTVAL]) {
+            case IPOPT_RR:
+                if (len < IPOPT_MINOFF - 1) return false;
+                out->overflow = 0;
+                parse_rr(opt, len, out);
+                return true;
+            case IPOPT_TS:
+                if (len < IPOPT_MINOFF) return false;
+                parse_ts(opt, len, out);
+                return true;
+            default:
+                opt += len;
+                break;
+        }
+    }
+
+    return false;
+}
+
+static void
+print_ts(const u32 ts, const u32 prev, const bool first) {
+    if (ts & IPOPT_TS_NONSTANDARD) {
+        printf("%u not-standard\n", ts & ~IPOPT_TS_NONSTANDARD);
+    } else if (first) {
+        printf("%u absolute\n", ts);
+    } else {
+        printf("%d\n", (i32)(ts - prev));
+    }
+}
+
+void
+print_ip_options(const IpOptRoute* route) {
+    char ip[INET_ADDRSTRLEN];
+
+    switch (route->kind) {
+        case IpOpt_RecordRoute:
+            for (u32 i = 0; i < route->count; i++) {
+                inet_ntop(AF_INET, &route->addr[i], ip, sizeof(ip));
+                printf("%s\t%s\n", i == 0 ? "RR: " : "", ip);
+            }
+            break;
+        case IpOpt_TsOnly:
+        case IpOpt_TsAndAddr:
+            for (u32 i = 0; i < route->count; i++) {
+                printf("%s\t", i == 0 ? "TS: " : "");
+                if (route->kind == IpOpt_TsAndAddr) {
+                    inet_ntop(AF_INET, &route->addr[i], ip, sizeof(ip));
+                    printf("%s\t", ip);
+                }
+                print_ts(route->ts[i], i > 0 ? route->ts[i - 1] : 0, i == 0);
+            }
+            if (route->overflow > 0) {
+                printf("\t(%u hops not recorded)\n", route->overflow);
+            }
+            break;
+        default:
+            break;
+    }
+}
@@ -0,0 +1,32 @@
+#pragma once
+
+#include "types.h"
+
+#include <netinet/ip.h>
+#include <stdbool.h>
+
+#define IPOPT_MAX_HOPS 9
+
+typedef enum {
+    IpOpt_None,
+    IpOpt_RecordRoute,
+    IpOpt_TsOnly,
+    IpOpt_TsAndAddr,
+} IpOptKind;
+
+typedef struct {
+    u8 kind;
+    u8 overflow;
+    u32 count;
+    struct in_addr addr[IPOPT_MAX_HOPS];
+    u32 ts[IPOPT_MAX_HOPS];
+} IpOptRoute;
+
+bool
+set_ip_options(const i32 fd, const IpOptKind kind);
+
+bool
+parse_ip_options(const struct ip* ip, IpOptRoute* out);
+
+void
+print_ip_options(const IpOptRoute* route);
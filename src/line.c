@@ -0,0 +1,64 @@
+#include "line.h"
+
+#include <stdio.h>
+#include <string.h>
+
+static const char hex_digits[] = "0123456789abcdef";
+
+void
+line_bytes(Line* line, const char* data, const u32 size) {
+    if (line->len + size > LINE_SIZE) return;
+    memcpy(line->data + line->len, data, size);
+    line->len += size;
+}
+
+void
+line_str(Line* line, const char* str) {
+    line_bytes(line, str, strlen(str));
+}
+
+void
+line_u64(Line* line, u64 value) {
+    char digits[20];
+    u32 i = sizeof(digits);
+    do {
+        digits[--i] = '0' + value % 10;
+        value /= 10;
+    } while (value > 0);
+    line_bytes(line, digits + i, sizeof(digits) - i);
+}
+
+void
+line_i64(Line* line, const i64 value) {
+    if (value < 0) {
+        line_bytes(line, "-", 1);
+        line_u64(line, -(u64)value);
+    } else {
+        line_u64(line, value);
+    }
+}
+
+void
+line_milli(Line* line, const i64 value) {
+    const u64 magnitude = value < 0 ? -(u64)value : (u64)value;
+    const u32 frac = magnitude % 1000;
+    const char decimals[4] = { '.', '0' + frac / 100, '0' + frac / 10 % 10, '0' + frac % 10 };
+
+    if (value < 0) line_bytes(line, "-", 1);
+    line_u64(line, magnitude / 1000);
+    line_bytes(line, decimals, sizeof(decimals));
+}
+
+void
+line_hex(Line* line, const u8* data, const u32 size, const bool grouped) {
+    for (u32 i = 0; i < size; i++) {
+        const char pair[3] = { hex_digits[data[i] >> 4], hex_digits[data[i] & 0xf], ' ' };
+        line_bytes(line, pair, grouped && i % 2 ? 3 : 2);
+    }
+}
+
+void
+line_flush(Line* line) {
+    fwrite(line->data, 1, line->len, stdout);
+    line->len = 0;
+}
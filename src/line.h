@@ -0,0 +1,38 @@
+#pragma once
+
+#include "types.h"
+
+#include <stdbool.h>
+
+#define LINE_SIZE 512
+
+// Output line assembled without printf. Appends past LINE_SIZE are dropped; a reply line is
+// well under it. line_flush() hands the whole line to stdio in one call, so a terminal gets one
+// write per line and a pipe gets whole lines batched into each buffer flush.
+typedef struct {
+    char data[LINE_SIZE];
+    u32 len;
+} Line;
+
+void
+line_bytes(Line* line, const char* data, const u32 size);
+
+void
+line_str(Line* line, const char* str);
+
+void
+line_u64(Line* line, u64 value);
+
+void
+line_i64(Line* line, const i64 value);
+
+// value / 1000 with three decimals, same output as printf("%.3f") on the exact quotient
+void
+line_milli(Line* line, const i64 value);
+
+// two lowercase hex digits per byte, a space after every second byte when grouped
+void
+line_hex(Line* line, const u8* data, const u32 size, const bool grouped);
+
+void
+line_flush(Line* line);
@@ -1,4 +1,18 @@
+#include "adapt.h"
+#include "arrow.h"
+#include "checkpoint.h"
+#include "coord.h"
+#include "dash.h"
+#include "hist.h"
+#include "instr.h"
+#include "ipopt.h"
+#include "line.h"
+#include "perf.h"
 #include "ping.h"
+#include "probes.h"
+#include "push.h"
+#include "store.h"
+#include "stream.h"
 #include "types.h"
 #include "utils.h"
 
@@ -22,24 +36,37 @@
 static const char* progname = NULL;
 PingData global_ping = { 0 };
 Options options = { .no_dns = true };
-Stats stats = { .min_rtt = FLT_MAX };
+Store store = { .fd = -1 };
+ArrowWriter arrow = { .fd = -1 };
+Checkpoint* checkpoint = NULL;
+Pusher pusher = { .fd = -1 };
+Coord coord = { .fd = -1 };
+Dashboard dash = { .last_rtt = NAN };
+Adaptive adapt = { 0 };
+SelfProfile profile = { 0 };
+Stats stats = { .min_rtt = FLT_MAX, .min_fwd = INT32_MAX, .min_rev = INT32_MAX };
 
-static void
-print_stats(void);
+static i32
+exit_status(const bool replied) {
+    return replied ? EXIT_SUCCESS : EXIT_NO_REPLY;
+}
+
+// Handlers only record the signal. The probe loop stops at its next check and the summary,
+// exporters and atexit handlers run from the main flow, so none of them can observe stats or an
+// export batch halfway through an update, or reenter stdio.
+static volatile sig_atomic_t stop_signal = 0;
 
 static void
-int_handler(int signal) {
-    (void)signal;
-    printf("\n");
-    print_stats();
-    exit(EXIT_SUCCESS);
+stop_handler(int signal) {
+    stop_signal = signal;
 }
 
+// without SA_RESTART, so a blocked recvmsg or sleep returns to the loop right away
 static void
-alarm_handler(int signal) {
-    (void)signal;
-    print_stats();
-    exit(EXIT_SUCCESS);
+on_signal(const i32 signal, void (*handler)(int)) {
+    struct sigaction action = { .sa_handler = handler };
+    sigemptyset(&action.sa_mask);
+    sigaction(signal, &action, NULL);
 }
 
 static void
@@ -58,6 +85,24 @@ usage(void) {
     print_option("-m <ttl>", "outgoing packets time to live");
     print_option("-t <timeout>", "time in seconds before program exits");
     print_option("-W <waittime>", "time in seconds to wait for a packet");
+    print_option("-A", "wait srtt + 4 rttvar for each reply, at most <waittime>");
+    print_option("-r <retries>", "probe again right away after a timeout, doubling the wait");
+    print_option("-w <deadline>", "time in milliseconds before program exits");
+    print_option("-i <interval>", "time in milliseconds between probes");
+    print_option("-a <max>", "adapt the interval up to <max> ms while the target is stable");
+    print_option("-1", "exit after the first reply, status 0 if one arrived");
+    print_option("-s <window>", "probe targets read from stdin, at most <window> in flight");
+    print_option("-L <pps>", "with -s, send at most <pps> probes per second");
+    print_option("-R", "record route");
+    print_option("-T <timestamp>", "ip timestamp option: tsonly or tsandaddr");
+    print_option("-S", "send icmp timestamp requests instead of echo requests");
+    print_option("-o <store>", "append every sample to a compressed store file");
+    print_option("-e <file>", "export probe results as an arrow ipc file");
+    print_option("-C <file>", "keep statistics in a checkpoint file and resume from it");
+    print_option("-u <dest>", "push histogram deltas to ft_ping_agg (host:port or socket path)");
+    print_option("-D", "live dashboard instead of a line per reply");
+    print_option("-P", "report perf counters per probe and per reply");
+    print_option("-j <peers>", "share targets with a fleet: self,peer,... as host:port");
 }
 
 static struct sockaddr_in
@@ -69,6 +114,10 @@ lookup_addr(const char* dst) {
     };
     struct addrinfo* result = NULL;
 
+    // dotted quads never need the resolver, which would load nss modules on first use
+    struct sockaddr_in out = { .sin_family = AF_INET };
+    if (inet_pton(AF_INET, dst, &out.sin_addr) == 1) return out;
+
     const i32 res = getaddrinfo((const char*)dst, NULL, &hints, &result);
     if (res != 0) {
         const char* err = gai_strerror(res);
@@ -76,7 +125,7 @@ lookup_addr(const char* dst) {
         exit(EXIT_FAILURE);
     }
 
-    struct sockaddr_in out = *(struct sockaddr_in*)result->ai_addr;
+    out = *(struct sockaddr_in*)result->ai_addr;
     freeaddrinfo(result);
 
     return out;
@@ -110,24 +159,14 @@ dns_lookup(struct sockaddr_in addr, char* buffer, const u64 buf_size) {
     return true;
 }
 
-static u16
-checksum(const void* data, u64 len) {
-    u32 sum = 0;
-
-    const u16* ptr;
-    for (ptr = data; len > 1; len -= 2) {
-        sum += *ptr;
-        ptr++;
-    }
-
-    if (len == 1) {
-        sum += *(const u8*)ptr;
-    }
-
-    sum = (sum >> 16) + (sum & 0xFFFF);
-    sum += (sum >> 16);
+static IcmpType
+reply_type(void) {
+    return options.icmp_timestamp ? Icmp_TimestampReply : Icmp_EchoReply;
+}
 
-    return ~sum;
+static u64
+packet_size(void) {
+    return options.icmp_timestamp ? TSSIZE : PKTSIZE;
 }
 
 static bool
@@ -138,11 +177,11 @@ decode_msg(const u8* buffer, const u64 buffer_size, Packet* out, struct ip** ip)
     Packet* pkt = (Packet*)(buffer + header_size);
     *out = *pkt;
 
-    if (pkt->header.type != Icmp_EchoReply) {
+    if (pkt->header.type != reply_type()) {
         return false;
     }
 
-    if (buffer_size < header_size + PKTSIZE) {
+    if (buffer_size < header_size + packet_size()) {
         return false;
     }
 
@@ -155,6 +194,39 @@ decode_msg(const u8* buffer, const u64 buffer_size, Packet* out, struct ip** ip)
     return true;
 }
 
+// icmp errors quote the header of the packet that caused them, only report those about the
+// probe in flight, a late error for an earlier probe must not end the current wait
+static bool
+is_own_error(
+    const u8* buffer,
+    const u64 buffer_size,
+    const struct ip* ip,
+    const pid_t pid,
+    const u16 seq
+) {
+    const u64 inner_offset = (ip->ip_hl << 2) + MIN_ICMPSIZE;
+    if (buffer_size < inner_offset + sizeof(struct ip)) return false;
+
+    const struct ip* inner = (const struct ip*)(buffer + inner_offset);
+    const u64 inner_size = inner->ip_hl << 2;
+    if (inner->ip_p != IPPROTO_ICMP) return false;
+    if (buffer_size < inner_offset + inner_size + MIN_ICMPSIZE) return false;
+
+    const IcmpEchoHeader* hdr = (const IcmpEchoHeader*)(buffer + inner_offset + inner_size);
+    return hdr->id == (u16)pid && hdr->seq == htons(seq);
+}
+
+// raw sockets see every icmp packet on the host, including replies to other ping processes
+static bool
+is_own_reply(
+    const Packet* pkt,
+    const struct sockaddr_in* src,
+    const PingData* ping,
+    const pid_t pid
+) {
+    return pkt->header.id == (u16)pid && src->sin_addr.s_addr == ping->addr.sin_addr.s_addr;
+}
+
 static void
 init_socket(const i32 fd, const i32 waittime) {
     if (options.ttl) {
@@ -166,12 +238,35 @@ init_socket(const i32 fd, const i32 waittime) {
         }
     }
 
+    if (!set_ip_options(fd, options.ip_options)) {
+        const char* err = strerror(errno);
+        dprintf(STDERR_FILENO, "%s: ip options: %s\n", progname, err);
+        exit(EXIT_FAILURE);
+    }
+
     const struct timeval tv = { .tv_sec = waittime };
     if (setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv)) != 0) {
         const char* err = strerror(errno);
         dprintf(STDERR_FILENO, "%s: %s\n", progname, err);
         exit(EXIT_FAILURE);
     }
+
+    // best effort, receive_time() falls back to gettimeofday without it
+    const i32 on = 1;
+    setsockopt(fd, SOL_SOCKET, SO_TIMESTAMP, &on, sizeof(on));
+}
+
+// kernel stamps the packet when it is queued on the socket, so the rtt does not include the
+// time the process took to get scheduled and return from recvmsg
+static void
+receive_time(struct msghdr* msg, struct timeval* out) {
+    for (struct cmsghdr* cmsg = CMSG_FIRSTHDR(msg); cmsg; cmsg = CMSG_NXTHDR(msg, cmsg)) {
+        if (cmsg->cmsg_level == SOL_SOCKET && cmsg->cmsg_type == SO_TIMESTAMP) {
+            memcpy(out, CMSG_DATA(cmsg), sizeof(*out));
+            return;
+        }
+    }
+    gettimeofday(out, NULL);
 }
 
 static Packet
@@ -193,16 +288,108 @@ init_packet(const pid_t pid, const u16 seq) {
     return pkt;
 }
 
+static Packet
+init_ts_packet(const pid_t pid, const u16 seq, struct timeval now) {
+    Packet pkt = {
+            .header = {
+                .type = Icmp_TimestampRequest,
+                .code = 0,
+                .id = pid,
+                .seq = htons(seq),
+            },
+            .ts = {
+                .originate = htonl(ms_since_midnight(now)),
+            },
+        };
+
+    pkt.header.cksum = checksum(&pkt, TSSIZE);
+
+    return pkt;
+}
+
+// rfc 1624 incremental update, avoids summing the whole packet again for a few changed words
+static void
+patch_packet(Packet* pkt, void* field, const void* value, const u32 size) {
+    u32 sum = (u16)~pkt->header.cksum;
+    for (u32 i = 0; i < size; i += sizeof(u16)) {
+        u16 old_word;
+        u16 new_word;
+        memcpy(&old_word, (const u8*)field + i, sizeof(u16));
+        memcpy(&new_word, (const u8*)value + i, sizeof(u16));
+        sum += (u16)~old_word + new_word;
+    }
+    memcpy(field, value, size);
+
+    sum = (sum >> 16) + (sum & 0xFFFF);
+    sum += (sum >> 16);
+    pkt->header.cksum = ~sum;
+}
+
+static void
+update_ts_stats(const IcmpTimestamps* ts, struct timeval end, i32* out_fwd, i32* out_rev) {
+    const i32 fwd = ms_diff(ntohl(ts->receive), ntohl(ts->originate));
+    const i32 rev = ms_diff(ms_since_midnight(end), ntohl(ts->transmit));
+    *out_fwd = fwd;
+    *out_rev = rev;
+
+    stats.ts_received++;
+    stats.sum_fwd += fwd;
+    stats.sum_rev += rev;
+    if (fwd < stats.min_fwd) stats.min_fwd = fwd;
+    if (rev < stats.min_rev) stats.min_rev = rev;
+}
+
+typedef struct {
+    struct in_addr addr;
+    bool valid;
+    Line text;
+} ReplyPrefix;
+
+// " bytes from host (ip): " is only rendered again when a reply comes from another address
+static const Line*
+reply_prefix(const struct sockaddr_in src) {
+    static ReplyPrefix cache;
+    if (cache.valid && cache.addr.s_addr == src.sin_addr.s_addr) return &cache.text;
+
+    char src_ip[INET_ADDRSTRLEN] = { 0 };
+    char addrname[NI_MAXHOST] = { 0 };
+    inet_ntop(AF_INET, &src.sin_addr.s_addr, src_ip, sizeof(src_ip));
+
+    cache.addr = src.sin_addr;
+    cache.valid = true;
+    cache.text.len = 0;
+    line_str(&cache.text, " bytes from ");
+    if (!options.no_dns && dns_lookup(src, addrname, sizeof(addrname))) {
+        line_str(&cache.text, addrname);
+        line_str(&cache.text, " (");
+        line_str(&cache.text, src_ip);
+        line_str(&cache.text, "): ");
+    } else {
+        line_str(&cache.text, src_ip);
+        line_str(&cache.text, ": ");
+    }
+
+    return &cache.text;
+}
+
+// "N bytes from host (ip): ", only for packets known to be ours so foreign sources are not resolved
+static void
+start_line(Line* line, const u64 size, const struct sockaddr_in* src) {
+    const Line* from = reply_prefix(*src);
+    line_u64(line, size);
+    line_bytes(line, from->data, from->len);
+}
+
 static void
 dump_ip_hdr(struct ip* ip, struct sockaddr_in* dst) {
-    u32 hlen = ip->ip_hl << 2;
-    u8* cp = (unsigned char*)ip + sizeof(*ip);
-    u32 j;
+    const u32 hlen = ip->ip_hl << 2;
+    const u8* cp = (const u8*)ip + sizeof(*ip);
 
-    printf("IP Hdr Dump:\n ");
-    for (j = 0; j < sizeof(*ip); ++j)
-        printf("%02x%s", *((unsigned char*)ip + j), (j % 2) ? " " : "");
-    printf("\n");
+    Line line = { 0 };
+    line_str(&line, "IP Hdr Dump:\n ");
+    line_hex(&line, (const u8*)ip, sizeof(*ip), true);
+    line_str(&line, "\n");
+    line_flush(&line);
 
     printf("Vr HL TOS  Len   ID Flg  off TTL Pro  cks      Src\tDst\tData\n");
     printf(" %1x  %1x  %02x", ip->ip_v, ip->ip_hl, ip->ip_tos);
@@ -211,9 +398,9 @@ dump_ip_hdr(struct ip* ip, struct sockaddr_in* dst) {
     printf("  %02x  %02x %04x", ip->ip_ttl, ip->ip_p, ntohs(ip->ip_sum));
     printf(" %s ", inet_ntoa(*((struct in_addr*)&ip->ip_src)));
     printf(" %s ", inet_ntoa(*((struct in_addr*)&dst->sin_addr.s_addr)));
-    while (hlen-- > sizeof(*ip)) printf("%02x", *cp++);
-
-    printf("\n");
+    if (hlen > sizeof(*ip)) line_hex(&line, cp, hlen - sizeof(*ip), false);
+    line_str(&line, "\n");
+    line_flush(&line);
 }
 
 static void
@@ -229,29 +416,140 @@ dump_packet(struct ip* ip, IcmpEchoHeader hdr, struct sockaddr_in* dst) {
     );
 }
 
-static bool
-ping_timeout(struct timeval starttime, const u32 waittime) {
+static i64
+elapsed_us(struct timeval since) {
     struct timeval now;
     gettimeofday(&now, NULL);
 
-    struct timeval diff = time_diff(now, starttime);
-    if (diff.tv_sec >= waittime) {
-        return true;
-    } else {
-        return false;
+    const struct timeval diff = time_diff(now, since);
+    return diff.tv_sec * 1000000 + diff.tv_usec;
+}
+
+static bool
+ping_timeout(struct timeval sent, const u64 timeout_us) {
+    return elapsed_us(sent) >= (i64)timeout_us;
+}
+
+// recvmsg returns at the probe's own deadline, whatever else arrived on the socket before it
+static void
+set_receive_timeout(const i32 fd, struct timeval sent, const u64 timeout_us) {
+    const i64 left_us = (i64)timeout_us - elapsed_us(sent);
+    const struct timeval tv = {
+        .tv_sec = left_us > 0 ? left_us / 1000000 : 0,
+        .tv_usec = left_us > 0 ? left_us % 1000000 : 1,
+    };
+    setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
+}
+
+static void
+record_sample(
+    struct timeval start,
+    const u16 seq,
+    const f64 rtt,
+    const struct ip* ip,
+    const u8 type
+) {
+    if (options.store_path != NULL && !store_append(&store, to_us(start), rtt)) {
+        const char* err = strerror(errno);
+        dprintf(STDERR_FILENO, "%s: %s: %s\n", progname, options.store_path, err);
+        exit(EXIT_FAILURE);
     }
+
+    if (options.export_path != NULL) {
+        const ArrowRow row = {
+            .ts_us = to_us(start),
+            .target = global_ping.dst,
+            .seq = seq,
+            .has_reply = ip != NULL,
+            .rtt_ns = ip != NULL ? llround(rtt * 1000000.0) : 0,
+            .ttl = ip != NULL ? ip->ip_ttl : 0,
+            .type = type,
+        };
+        if (!arrow_append(&arrow, &row)) {
+            const char* err = strerror(errno);
+            dprintf(STDERR_FILENO, "%s: %s: %s\n", progname, options.export_path, err);
+            exit(EXIT_FAILURE);
+        }
+    }
+
+    if (options.dashboard) {
+        dash_sample(&dash, ip != NULL ? rtt : NAN);
+    }
+}
+
+static void
+close_export(void) {
+    if (!arrow_close(&arrow)) {
+        const char* err = strerror(errno);
+        dprintf(STDERR_FILENO, "%s: %s: %s\n", progname, options.export_path, err);
+    }
+}
+
+static void
+save_checkpoint(void) {
+    if (checkpoint == NULL) return;
+
+    checkpoint->stats = stats;
+    checkpoint->seq = global_ping.seq;
+    memcpy(checkpoint->bits_duplicate, global_ping.bits_duplicate, DUP_TABLE_SIZE);
+    checkpoint->resumable = true;
+}
+
+// restores counters and sequence state, then waits so probes keep the interval phase they had
+// before the restart instead of firing as soon as the process comes up
+static void
+resume_checkpoint(PingData* ping) {
+    if (!checkpoint->resumable) return;
+
+    stats = checkpoint->stats;
+    ping->seq = checkpoint->seq;
+    memcpy(ping->bits_duplicate, checkpoint->bits_duplicate, DUP_TABLE_SIZE);
+    // everything up to the restart was pushed by the previous process
+    pusher.sent = stats;
+
+    struct timeval now;
+    gettimeofday(&now, NULL);
+    const u64 period_us = adapt.min_interval_us;
+    const u64 at = to_us(now) % period_us;
+    usleep((checkpoint->phase_us % period_us + period_us - at) % period_us);
+}
+
+static void
+push_final_stats(void) {
+    push_stats(&pusher, &stats);
+}
+
+// a run can end before its first probe, a non-owner -j instance or -w firing early
+static u32
+loss_percent(const u32 lost) {
+    if (stats.pkt_transmitted == 0) return 0;
+    return (u32)((float)lost / stats.pkt_transmitted * 100.0);
 }
 
 static void
 print_stats(void) {
+    if (options.dashboard) {
+        dash_render(&dash, &global_ping, &stats, true);
+    }
+
     printf("--- %s ping statistics ---\n", global_ping.dst);
     printf(
         "%u packets transmitted, %u received, %u%% packet loss\n",
         stats.pkt_transmitted,
         stats.pkt_received,
-        (u32)((float)(stats.pkt_transmitted - stats.pkt_received) / stats.pkt_transmitted * 100.0)
+        loss_percent(stats.pkt_transmitted - stats.pkt_received)
     );
 
+    if (options.retries_value > 0) {
+        const u32 first_received = stats.pkt_received - stats.retry_received;
+        printf(
+            "%u retries, %u answered after a retry, %u%% first attempt loss\n",
+            stats.retries,
+            stats.retry_received,
+            loss_percent(stats.pkt_transmitted - first_received)
+        );
+    }
+
     if (stats.pkt_received > 0) {
         const f64 total = stats.pkt_received + stats.pkt_duplicate;
         const f64 avg = stats.sum_rtt / total;
@@ -263,47 +561,155 @@ print_stats(void) {
             stats.max_rtt,
             sqrt(variation)
         );
+
+        if (options.verbose) {
+            printf(
+                "round-trip p50/p90/p99 = %.3f/%.3f/%.3f ms\n",
+                hist_percentile(&stats.hist, 50.0) / 1000.0,
+                hist_percentile(&stats.hist, 90.0) / 1000.0,
+                hist_percentile(&stats.hist, 99.0) / 1000.0
+            );
+        }
+    }
+
+    if (options.verbose) {
+        instr_print();
+    }
+
+    if (options.self_profile) {
+        perf_print(&profile, stats.pkt_transmitted, stats.pkt_received);
+    }
+
+    if (stats.ts_received > 0) {
+        // Each one-way delay includes the remote clock offset with opposite sign. The minimum
+        // of each direction is the closest to the propagation delay, so half their difference
+        // estimates the offset, while excess over the minimum is queueing on that path.
+        const f64 avg_fwd = stats.sum_fwd / stats.ts_received;
+        const f64 avg_rev = stats.sum_rev / stats.ts_received;
+        printf(
+            "timestamp fwd min/avg = %d/%.3f ms, rev min/avg = %d/%.3f ms\n",
+            stats.min_fwd,
+            avg_fwd,
+            stats.min_rev,
+            avg_rev
+        );
+        printf(
+            "clock offset ~ %.1f ms, queueing asymmetry fwd-rev = %.3f ms\n",
+            (stats.min_fwd - stats.min_rev) / 2.0,
+            (avg_fwd - stats.min_fwd) - (avg_rev - stats.min_rev)
+        );
     }
 }
 
-static void
+// returns whether this run got a reply, stats also carry the totals of a resumed checkpoint
+static bool
 send_ping(PingData* ping) {
     const pid_t pid = getpid();
 
-    if (options.timeout) {
-        alarm(options.timeout_value);
-        signal(SIGALRM, alarm_handler);
+    // -t and -w share the one ITIMER_REAL, so arm it once for whichever ends first
+    if (options.timeout || options.deadline) {
+        u64 stop_ms = options.timeout ? (u64)options.timeout_value * 1000 : UINT64_MAX;
+        if (options.deadline && (u64)options.deadline_value < stop_ms) {
+            stop_ms = (u64)options.deadline_value;
+        }
+        const struct itimerval deadline = {
+            .it_value = {
+                .tv_sec = stop_ms / 1000,
+                .tv_usec = stop_ms % 1000 * 1000,
+            },
+        };
+        on_signal(SIGALRM, stop_handler);
+        setitimer(ITIMER_REAL, &deadline, NULL);
     }
 
     init_socket(ping->fd, options.waittime_value);
 
-    printf("PING %s (%s) %lu data bytes", ping->dst, ping->ip, sizeof(Packet) - MIN_ICMPSIZE);
+    printf("PING %s (%s) %lu data bytes", ping->dst, ping->ip, packet_size() - MIN_ICMPSIZE);
     if (options.verbose) {
         printf(", id 0x%04x = %d", pid, pid);
     }
     printf("\n");
 
-    u16 msg_count = 0;
+    if (checkpoint != NULL) {
+        resume_checkpoint(ping);
+    }
+
+    u64 run_transmitted = 0;
+    u64 run_received = 0;
+    bool owned = false;
+    u32 attempt = 0;
 
-    u64 pkt_duplicate = 0;
-    u8 bits_duplicate[128] = { 0 };
+    Packet pkt = options.icmp_timestamp ? init_ts_packet(pid, ping->seq, (struct timeval){ 0 })
+                                        : init_packet(pid, ping->seq);
 
-    while (true) {
-        Packet pkt = init_packet(pid, msg_count++);
+    instr_init();
+    if (options.self_profile) {
+        perf_enable(&profile);
+    }
+
+    while (!stop_signal && (!options.one_shot || run_transmitted == 0 || attempt > 0)) {
+        if (options.peers != NULL) {
+            const bool owns = coord_owns(&coord, ping->dst);
+            if (options.verbose && owns != owned) {
+                printf("%s: %s %s\n", coord.self, owns ? "now probing" : "handing off", ping->dst);
+            }
+            owned = owns;
+
+            if (!owns) {
+                if (options.dashboard) dash_render(&dash, ping, &stats, false);
+                usleep(adapt.min_interval_us);
+                continue;
+            }
+        }
 
         struct timeval start;
         gettimeofday(&start, NULL);
 
+        if (checkpoint != NULL) {
+            if (!checkpoint->resumable) {
+                checkpoint->phase_us = to_us(start) % adapt.min_interval_us;
+            }
+            save_checkpoint();
+            if (ping->seq % CHECKPOINT_SYNC_PROBES == 0) checkpoint_sync(checkpoint);
+        }
+
+        if (options.push_dest != NULL && ping->seq % PUSH_INTERVAL_PROBES == 0) {
+            push_stats(&pusher, &stats);
+        }
+
+        u64 tick = instr_now();
+
+        const u16 seq = htons(ping->seq);
+        patch_packet(&pkt, &pkt.header.seq, &seq, sizeof(seq));
+        if (options.icmp_timestamp) {
+            const u32 originate = htonl(ms_since_midnight(start));
+            patch_packet(&pkt, &pkt.ts.originate, &originate, sizeof(originate));
+        }
+        ping->bits_duplicate[(ping->seq / 8) % DUP_TABLE_SIZE] &= ~(1 << (ping->seq % 8));
+        ping->seq++;
+        tick = instr_end(Stage_Build, tick);
+
+        const u64 waittime_us = (u64)options.waittime_value * 1000000;
+        u64 timeout_us = options.adaptive_timeout ? adapt_rto(&adapt, waittime_us) : waittime_us;
+        // each retry waits twice as long as the attempt before it, up to the wait time
+        for (u32 i = 0; i < attempt && timeout_us < waittime_us; i++) timeout_us *= 2;
+        if (timeout_us > waittime_us) timeout_us = waittime_us;
+
+        struct timeval sent;
+        gettimeofday(&sent, NULL);
+        ping->sent[(ping->seq - 1) % (DUP_TABLE_SIZE * 8)] = sent;
         const i64 res = sendto(
             ping->fd,
             &pkt,
-            sizeof(pkt),
+            packet_size(),
             0,
             (struct sockaddr*)&ping->addr,
             sizeof(struct sockaddr)
         );
+        instr_end(Stage_Send, tick);
+        PROBE_SEND(ping->dst, (u16)(ping->seq - 1));
 
-        if (ping_timeout(start, options.waittime_value)) continue;
+        if (ping_timeout(sent, timeout_us)) continue;
 
         if (res == 0) {
             dprintf(STDERR_FILENO, "%s: socket closed\n", progname);
@@ -316,27 +722,46 @@ send_ping(PingData* ping) {
             exit(EXIT_FAILURE);
         }
 
-        stats.pkt_transmitted++;
+        if (attempt == 0) {
+            stats.pkt_transmitted++;
+            run_transmitted++;
+        } else {
+            stats.retries++;
+        }
 
+    receive:;
         u8 buffer[256];
         struct iovec iov = {
             .iov_base = buffer,
             .iov_len = sizeof(buffer),
         };
 
+        u8 control[CMSG_SPACE(sizeof(struct timeval))];
         struct sockaddr_in addr = ping->addr;
         struct msghdr rmsg = {
             .msg_name = &addr,
             .msg_namelen = sizeof(ping->addr),
             .msg_iov = &iov,
             .msg_iovlen = 1,
+            .msg_control = control,
+            .msg_controllen = sizeof(control),
         };
+        set_receive_timeout(ping->fd, sent, timeout_us);
+        tick = instr_now();
         const ssize_t bytes = recvmsg(ping->fd, &rmsg, 0);
-
-        struct timeval end;
-        gettimeofday(&end, NULL);
-
-        if (ping_timeout(start, options.waittime_value)) continue;
+        tick = instr_end(Stage_Receive, tick);
+        if (stop_signal) break;
+
+        if (ping_timeout(sent, timeout_us)) {
+            PROBE_TIMEOUT(ping->dst, (u16)(ping->seq - 1));
+            adapt_loss(&adapt);
+            if (attempt < (u32)options.retries_value) {
+                attempt++;
+                continue;
+            }
+            record_sample(start, ping->seq - 1, NAN, NULL, 0);
+            goto next_ping;
+        }
 
         if (bytes == 0) {
             dprintf(STDERR_FILENO, "%s: socket closed\n", progname);
@@ -349,34 +774,41 @@ send_ping(PingData* ping) {
             exit(EXIT_FAILURE);
         }
 
+        // the control buffer is only filled in by a successful recvmsg
+        struct timeval end;
+        receive_time(&rmsg, &end);
+
         Packet r_pkt;
         struct ip* ip;
 
         const bool receive_success = decode_msg(buffer, bytes, &r_pkt, &ip);
+        tick = instr_end(Stage_Decode, tick);
 
-        char src_ip[INET_ADDRSTRLEN] = { 0 };
-        char addrname[NI_MAXHOST] = { 0 };
-
-        struct sockaddr_in* src_addr = rmsg.msg_name;
-        inet_ntop(AF_INET, &src_addr->sin_addr.s_addr, src_ip, sizeof(src_ip));
-        const bool dns_lookup_success = dns_lookup(*src_addr, addrname, sizeof(addrname));
+        const struct sockaddr_in* src_addr = rmsg.msg_name;
+        Line line = { 0 };
 
         if (!receive_success) {
+            const u16 probe_seq = ping->seq - 1;
             switch (r_pkt.header.type) {
                 case Icmp_TimeExceeded:
+                    if (!is_own_error(buffer, bytes, ip, pid, probe_seq)) goto receive;
+                    if (options.dashboard) break;
+
                     if (options.verbose) {
                         dump_packet(ip, pkt.header, (struct sockaddr_in*)&ping->addr);
                     }
 
-                    printf("%lu bytes from ", bytes - (ip->ip_hl << 2));
-                    if (!options.no_dns && dns_lookup_success) {
-                        printf("%s (%s): ", addrname, src_ip);
-                    } else {
-                        printf("%s: ", src_ip);
-                    }
-                    printf("Time to live exceeded\n");
+                    start_line(&line, bytes - (ip->ip_hl << 2), src_addr);
+                    line_str(&line, "Time to live exceeded\n");
+                    line_flush(&line);
                     break;
                 case Icmp_EchoReply:
+                case Icmp_TimestampReply:
+                    // the other reply type or a reply to another pinger is not a corrupt answer
+                    if (r_pkt.header.type != reply_type()) goto receive;
+                    if (!is_own_reply(&r_pkt, src_addr, ping, pid)) goto receive;
+                    if (options.dashboard) break;
+
                     if (options.verbose) {
                         dump_packet(ip, pkt.header, (struct sockaddr_in*)&ping->addr);
                     }
@@ -384,10 +816,13 @@ send_ping(PingData* ping) {
                     printf("checksum mismatch\n");
                     break;
                 case Icmp_EchoRequest:
-                    // from localhost
-                    stats.pkt_transmitted--;
-                    continue;
+                case Icmp_TimestampRequest:
+                    // our own request looped back from localhost, the reply is still queued
+                    goto receive;
                 default:
+                    if (!is_own_error(buffer, bytes, ip, pid, probe_seq)) goto receive;
+                    if (options.dashboard) break;
+
                     if (options.verbose) {
                         dump_packet(ip, pkt.header, (struct sockaddr_in*)&ping->addr);
                     }
@@ -396,48 +831,106 @@ send_ping(PingData* ping) {
                     break;
             }
 
+            if (options.dashboard) dash_sample(&dash, NAN);
+            adapt_loss(&adapt);
             goto next_ping;
         }
 
+        if (!is_own_reply(&r_pkt, src_addr, ping, pid)) goto receive;
+
         const u16 packet_seq = ntohs(r_pkt.header.seq);
-        const u64 bit_index = (packet_seq / 8) % sizeof(bits_duplicate);
+        const u64 bit_index = (packet_seq / 8) % DUP_TABLE_SIZE;
         const u64 bit_mask = 1 << (packet_seq % 8);
 
+        // a first reply to an earlier probe came after that probe timed out, it is not a
+        // sample of the current one; duplicates of answered probes are still reported
+        const bool answered = ping->bits_duplicate[bit_index] & bit_mask;
+        if (packet_seq != (u16)(ping->seq - 1) && !answered) goto receive;
+
         bool is_dup;
-        if (bits_duplicate[bit_index] & bit_mask) {
-            pkt_duplicate++;
+        if (answered) {
+            PROBE_DUPLICATE(ping->dst, packet_seq);
+            stats.pkt_duplicate++;
             is_dup = true;
         } else {
             stats.pkt_received++;
+            run_received++;
+            if (attempt > 0) stats.retry_received++;
             is_dup = false;
         }
-        bits_duplicate[bit_index] |= bit_mask;
-
-        const f64 time = to_ms(time_diff(end, start));
+        ping->bits_duplicate[bit_index] |= bit_mask;
+
+        const struct timeval rtt =
+            time_diff(end, ping->sent[packet_seq % (DUP_TABLE_SIZE * 8)]);
+        const i64 rtt_us = rtt.tv_sec * 1000000 + rtt.tv_usec;
+        const f64 time = to_ms(rtt);
+        const i64 time_ns = time * 1000000.0;
+        PROBE_REPLY(ping->dst, packet_seq, time_ns);
         stats.sum_rtt += time;
         stats.sumsq_rtt += time * time;
         if (time > stats.max_rtt) stats.max_rtt = time;
         if (time < stats.min_rtt) stats.min_rtt = time;
+        hist_add(&stats.hist, time * 1000.0);
 
-        printf("%lu bytes from ", bytes - (ip->ip_hl << 2));
-
-        if (!options.no_dns && dns_lookup_success) {
-            printf("%s (%s): ", addrname, src_ip);
-        } else {
-            printf("%s: ", src_ip);
+        i32 fwd = 0;
+        i32 rev = 0;
+        if (options.icmp_timestamp && !is_dup) {
+            update_ts_stats(&r_pkt.ts, end, &fwd, &rev);
+        }
+        if (!is_dup) adapt_reply(&adapt, time);
+        PROBE_STATS(ping->dst, stats.pkt_transmitted, stats.pkt_received, time_ns);
+
+        record_sample(start, packet_seq, time, ip, r_pkt.header.type);
+        tick = instr_end(Stage_Stats, tick);
+
+        if (options.dashboard) goto output_done;
+
+        start_line(&line, bytes - (ip->ip_hl << 2), src_addr);
+        tick = instr_end(Stage_Resolve, tick);
+
+        line_str(&line, "icmp_seq=");
+        line_u64(&line, packet_seq);
+        line_str(&line, " ttl=");
+        line_u64(&line, ip->ip_ttl);
+        line_str(&line, " time=");
+        line_milli(&line, rtt_us);
+        line_str(&line, " ms");
+        if (options.icmp_timestamp && !is_dup) {
+            line_str(&line, " fwd=");
+            line_i64(&line, fwd);
+            line_str(&line, " ms rev=");
+            line_i64(&line, rev);
+            line_str(&line, " ms");
         }
-
-        printf("icmp_seq=%u ttl=%u time=%.3lf ms", packet_seq, ip->ip_ttl, time);
         if (is_dup) {
-            printf(" (DUP!)");
+            line_str(&line, " (DUP!)");
+        }
+        line_str(&line, "\n");
+        line_flush(&line);
+
+        IpOptRoute route;
+        if (options.ip_options != IpOpt_None && parse_ip_options(ip, &route)) {
+            print_ip_options(&route);
         }
-        printf("\n");
 
+    output_done:
+        instr_end(Stage_Output, tick);
+        // the current probe is still waiting for its own reply
+        if (is_dup) goto receive;
     next_ping:
-        usleep(1000 * 1000);
+        // every probe outcome redraws, dash_render() keeps the frame rate down
+        if (options.dashboard) dash_render(&dash, ping, &stats, false);
+        attempt = 0;
+        if (options.one_shot) break;
+
+        // probes keep their cadence however long the reply or the timeout took
+        const i64 wait_us = (i64)adapt.interval_us - elapsed_us(sent);
+        if (wait_us > 0) usleep(wait_us);
     }
 
+    if (stop_signal == SIGINT) printf("\n");
     print_stats();
+    return run_received > 0;
 }
 
 static void
@@ -455,6 +948,26 @@ is_greater_than_zero(const i32 value) {
     return value > 0;
 }
 
+static bool
+is_not_negative(const i32 value) {
+    return value >= 0;
+}
+
+static bool
+is_valid_window(const i32 value) {
+    return value > 0 && value <= STREAM_MAX_WINDOW;
+}
+
+static const char*
+get_flag_arg(const i32 argc, const char* const* argv, const i32 index) {
+    if (index + 1 >= argc) {
+        usage();
+        exit(EXIT_FAILURE);
+    }
+
+    return argv[index + 1];
+}
+
 static i32
 get_flag_value(
     const i32 argc,
@@ -463,14 +976,7 @@ get_flag_value(
     const char* name,
     bool (*is_valid)(const i32)
 ) {
-    i32 result = -1;
-
-    if (index + 1 >= argc) {
-        usage();
-        exit(EXIT_FAILURE);
-    }
-
-    result = atoi(argv[index + 1]);
+    const i32 result = atoi(get_flag_arg(argc, argv, index));
     if (!is_valid(result)) {
         dprintf(STDERR_FILENO, "%s: invalid %s value: '%d'\n", progname, name, result);
         exit(EXIT_FAILURE);
@@ -526,6 +1032,102 @@ parse_options(const i32 argc, const char* const* argv) {
                     next_arg = true;
                     goto next;
                 } break;
+                case 'w': {
+                    out.deadline = true;
+                    out.deadline_value =
+                        get_flag_value(argc, argv, i, "deadline", &is_greater_than_zero);
+                    next_arg = true;
+                    goto next;
+                } break;
+                case '1':
+                    out.one_shot = true;
+                    break;
+                case 'A':
+                    out.adaptive_timeout = true;
+                    break;
+                case 'r': {
+                    out.retries_value = get_flag_value(argc, argv, i, "retries", &is_not_negative);
+                    next_arg = true;
+                    goto next;
+                } break;
+                case 's': {
+                    out.stream = true;
+                    out.stream_window = get_flag_value(argc, argv, i, "window", &is_valid_window);
+                    next_arg = true;
+                    goto next;
+                } break;
+                case 'L': {
+                    out.rate_value = get_flag_value(argc, argv, i, "rate", &is_greater_than_zero);
+                    next_arg = true;
+                    goto next;
+                } break;
+                case 'i': {
+                    out.interval_value =
+                        get_flag_value(argc, argv, i, "interval", &is_greater_than_zero);
+                    next_arg = true;
+                    goto next;
+                } break;
+                case 'a': {
+                    out.adaptive_value =
+                        get_flag_value(argc, argv, i, "max interval", &is_greater_than_zero);
+                    next_arg = true;
+                    goto next;
+                } break;
+                case 'D':
+                    out.dashboard = true;
+                    break;
+                case 'P':
+                    out.self_profile = true;
+                    break;
+                case 'S':
+                    out.icmp_timestamp = true;
+                    break;
+                case 'o': {
+                    out.store_path = get_flag_arg(argc, argv, i);
+                    next_arg = true;
+                    goto next;
+                } break;
+                case 'e': {
+                    out.export_path = get_flag_arg(argc, argv, i);
+                    next_arg = true;
+                    goto next;
+                } break;
+                case 'C': {
+                    out.checkpoint_path = get_flag_arg(argc, argv, i);
+                    next_arg = true;
+                    goto next;
+                } break;
+                case 'u': {
+                    out.push_dest = get_flag_arg(argc, argv, i);
+                    next_arg = true;
+                    goto next;
+                } break;
+                case 'j': {
+                    out.peers = get_flag_arg(argc, argv, i);
+                    next_arg = true;
+                    goto next;
+                } break;
+                case 'R':
+                    out.ip_options = IpOpt_RecordRoute;
+                    break;
+                case 'T': {
+                    const char* value = get_flag_arg(argc, argv, i);
+                    if (strcmp(value, "tsonly") == 0) {
+                        out.ip_options = IpOpt_TsOnly;
+                    } else if (strcmp(value, "tsandaddr") == 0) {
+                        out.ip_options = IpOpt_TsAndAddr;
+                    } else {
+                        dprintf(
+                            STDERR_FILENO,
+                            "%s: invalid timestamp type: '%s'\n",
+                            progname,
+                            value
+                        );
+                        exit(EXIT_FAILURE);
+                    }
+                    next_arg = true;
+                    goto next;
+                } break;
                 default:
                     dprintf(STDERR_FILENO, "%s: invalid flag: '%s'\n", progname, argv[i]);
                     exit(EXIT_FAILURE);
@@ -558,7 +1160,7 @@ main(int argc, const char* const* argv) {
         exit(EXIT_FAILURE);
     }
 
-    if (options.dst == NULL) {
+    if (options.dst == NULL && !options.stream) {
         dprintf(STDERR_FILENO, "%s: usage error: destination address required\n", progname);
         exit(EXIT_FAILURE);
     }
@@ -569,10 +1171,25 @@ main(int argc, const char* const* argv) {
         options.waittime_value = 5;
     }
 
-    global_ping.dst = options.dst;
-    global_ping.addr = lookup_addr(global_ping.dst);
-    inet_ntop(AF_INET, &global_ping.addr.sin_addr.s_addr, global_ping.ip, INET_ADDRSTRLEN);
-    dns_lookup(global_ping.addr, global_ping.host, sizeof(global_ping.host));
+    const u64 interval_us =
+        options.interval_value > 0 ? (u64)options.interval_value * 1000 : PING_INTERVAL_US;
+    const u64 max_interval_us = (u64)options.adaptive_value * 1000;
+    if (options.adaptive_value > 0 && max_interval_us < interval_us) {
+        dprintf(
+            STDERR_FILENO,
+            "%s: invalid max interval value: '%d'\n",
+            progname,
+            options.adaptive_value
+        );
+        exit(EXIT_FAILURE);
+    }
+    adapt_init(&adapt, interval_us, options.adaptive_value > 0 ? max_interval_us : interval_us);
+
+    if (!options.stream) {
+        global_ping.dst = options.dst;
+        global_ping.addr = lookup_addr(global_ping.dst);
+        inet_ntop(AF_INET, &global_ping.addr.sin_addr.s_addr, global_ping.ip, INET_ADDRSTRLEN);
+    }
 
     global_ping.fd = socket(AF_INET, SOCK_RAW, IPPROTO_ICMP);
 
@@ -586,9 +1203,83 @@ main(int argc, const char* const* argv) {
         exit(EXIT_FAILURE);
     }
 
-    signal(SIGINT, int_handler);
+    if (options.stream) {
+        init_socket(global_ping.fd, options.waittime_value);
+        const bool ok = stream_targets(
+            global_ping.fd,
+            options.stream_window,
+            options.waittime_value,
+            options.rate_value
+        );
+        if (!ok) {
+            const char* err = strerror(errno);
+            dprintf(STDERR_FILENO, "%s: %s\n", progname, err);
+            exit(EXIT_FAILURE);
+        }
+        close(global_ping.fd);
+        return EXIT_SUCCESS;
+    }
+
+    if (options.store_path != NULL && !store_open(&store, options.store_path)) {
+        const char* err = strerror(errno);
+        dprintf(STDERR_FILENO, "%s: %s: %s\n", progname, options.store_path, err);
+        exit(EXIT_FAILURE);
+    }
 
-    send_ping(&global_ping);
+    if (options.export_path != NULL) {
+        if (!arrow_open(&arrow, options.export_path)) {
+            const char* err = strerror(errno);
+            dprintf(STDERR_FILENO, "%s: %s: %s\n", progname, options.export_path, err);
+            exit(EXIT_FAILURE);
+        }
+        atexit(close_export);
+    }
+
+    if (options.checkpoint_path != NULL) {
+        checkpoint = checkpoint_open(options.checkpoint_path, global_ping.addr.sin_addr);
+        if (checkpoint == NULL) {
+            const char* err = strerror(errno);
+            dprintf(STDERR_FILENO, "%s: %s: %s\n", progname, options.checkpoint_path, err);
+            exit(EXIT_FAILURE);
+        }
+        atexit(save_checkpoint);
+    }
+
+    if (options.push_dest != NULL) {
+        if (!push_open(&pusher, options.push_dest)) {
+            dprintf(
+                STDERR_FILENO,
+                "%s: invalid push destination: '%s'\n",
+                progname,
+                options.push_dest
+            );
+            exit(EXIT_FAILURE);
+        }
+        atexit(push_final_stats);
+    }
+
+    // a round lasts at most one reply wait or one interval, heartbeats go out once per round
+    const u64 waittime_us = (u64)options.waittime_value * 1000000;
+    const u64 round_us =
+        waittime_us > adapt.max_interval_us ? waittime_us : adapt.max_interval_us;
+    if (options.peers != NULL && !coord_open(&coord, options.peers, round_us)) {
+        const char* err = strerror(errno);
+        dprintf(STDERR_FILENO, "%s: peers '%s': %s\n", progname, options.peers, err);
+        exit(EXIT_FAILURE);
+    }
+
+    if (options.self_profile && !perf_open(&profile)) {
+        const char* err = strerror(errno);
+        dprintf(STDERR_FILENO, "%s: perf counters: %s\n", progname, err);
+        exit(EXIT_FAILURE);
+    }
+
+    on_signal(SIGINT, stop_handler);
+
+    const bool replied = send_ping(&global_ping);
 
     close(global_ping.fd);
+    store_close(&store);
+
+    return exit_status(replied);
 }
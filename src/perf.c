@@ -0,0 +1,101 @@
+#include "perf.h"
+
+#include <linux/perf_event.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+typedef struct {
+    const char* name;
+    u32 type;
+    u64 config;
+} PerfEvent;
+
+typedef struct {
+    PerfEvent event;
+    PerfEvent fallback;
+} PerfWanted;
+
+static const PerfWanted wanted[PERF_MAX_COUNTERS] = {
+    {
+        { "cycles", PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES },
+        { "task-clock ns", PERF_TYPE_SOFTWARE, PERF_COUNT_SW_TASK_CLOCK },
+    },
+    { { "instructions", PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS }, { 0 } },
+    { { "cache-misses", PERF_TYPE_HARDWARE, PERF_COUNT_HW_CACHE_MISSES }, { 0 } },
+    { { "context-switches", PERF_TYPE_SOFTWARE, PERF_COUNT_SW_CONTEXT_SWITCHES }, { 0 } },
+    { { "page-faults", PERF_TYPE_SOFTWARE, PERF_COUNT_SW_PAGE_FAULTS }, { 0 } },
+};
+
+static i32
+open_event(const PerfEvent* event) {
+    struct perf_event_attr attr = {
+        .type = event->type,
+        .size = sizeof(attr),
+        .config = event->config,
+        .disabled = 1,
+        .read_format = PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING,
+    };
+
+    i32 fd = syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0);
+    if (fd < 0) {
+        // unprivileged under perf_event_paranoid >= 2: count user space only
+        attr.exclude_kernel = 1;
+        attr.exclude_hv = 1;
+        fd = syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0);
+    }
+    return fd;
+}
+
+bool
+perf_open(SelfProfile* profile) {
+    memset(profile, 0, sizeof(*profile));
+
+    for (u32 i = 0; i < PERF_MAX_COUNTERS; i++) {
+        const PerfEvent* event = &wanted[i].event;
+        i32 fd = open_event(event);
+        if (fd < 0 && wanted[i].fallback.name != NULL) {
+            event = &wanted[i].fallback;
+            fd = open_event(event);
+        }
+        if (fd < 0) continue;
+
+        profile->counters[profile->count++] = (PerfCounter){ .name = event->name, .fd = fd };
+    }
+
+    return profile->count > 0;
+}
+
+void
+perf_enable(SelfProfile* profile) {
+    for (u32 i = 0; i < profile->count; i++) {
+        ioctl(profile->counters[i].fd, PERF_EVENT_IOC_RESET, 0);
+        ioctl(profile->counters[i].fd, PERF_EVENT_IOC_ENABLE, 0);
+    }
+}
+
+static f64
+read_counter(const PerfCounter* counter) {
+    u64 values[3];
+    if (read(counter->fd, values, sizeof(values)) != sizeof(values)) return 0.0;
+
+    // scale up if the counter was multiplexed with others
+    if (values[2] == 0) return 0.0;
+    return (f64)values[0] * values[1] / values[2];
+}
+
+void
+perf_print(const SelfProfile* profile, const u32 probes, const u32 replies) {
+    printf("%-18s%14s%14s\n", "self-profile", "per probe", "per reply");
+    for (u32 i = 0; i < profile->count; i++) {
+        const f64 value = read_counter(&profile->counters[i]);
+        printf(
+            "%-18s%14.1f%14.1f\n",
+            profile->counters[i].name,
+            probes > 0 ? value / probes : 0.0,
+            replies > 0 ? value / replies : 0.0
+        );
+    }
+}
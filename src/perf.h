@@ -0,0 +1,28 @@
+#pragma once
+
+#include "types.h"
+
+#include <stdbool.h>
+
+#define PERF_MAX_COUNTERS 5
+
+typedef struct {
+    const char* name;
+    i32 fd;
+} PerfCounter;
+
+// Per-process perf counters around the probe loop. Hardware events fall back to their
+// software equivalent, or are dropped, on machines without a usable PMU (most VMs).
+typedef struct {
+    PerfCounter counters[PERF_MAX_COUNTERS];
+    u32 count;
+} SelfProfile;
+
+bool
+perf_open(SelfProfile* profile);
+
+void
+perf_enable(SelfProfile* profile);
+
+void
+perf_print(const SelfProfile* profile, const u32 probes, const u32 replies);
@@ -1,18 +1,27 @@
 #pragma once
 
+#include "hist.h"
+#include "ipopt.h"
 #include "types.h"
 
 #include <netdb.h>
 #include <netinet/in.h>
 #include <stdbool.h>
+#include <sys/time.h>
 
 #define PKTSIZE 64
 #define MIN_ICMPSIZE 8
+#define DUP_TABLE_SIZE 128
+#define PING_INTERVAL_US (1000 * 1000)
+#define TSSIZE (MIN_ICMPSIZE + 3 * sizeof(u32))
+#define EXIT_NO_REPLY 2
 
 typedef enum {
     Icmp_EchoReply = 0,
     Icmp_EchoRequest = 8,
     Icmp_TimeExceeded = 11,
+    Icmp_TimestampRequest = 13,
+    Icmp_TimestampReply = 14,
 } IcmpType;
 
 typedef struct {
@@ -23,17 +32,28 @@ typedef struct {
     u16 seq;
 } IcmpEchoHeader;
 
+typedef struct {
+    u32 originate;
+    u32 receive;
+    u32 transmit;
+} IcmpTimestamps;
+
 typedef struct {
     IcmpEchoHeader header;
-    u8 msg[PKTSIZE - sizeof(IcmpEchoHeader)];
+    union {
+        u8 msg[PKTSIZE - sizeof(IcmpEchoHeader)];
+        IcmpTimestamps ts;
+    };
 } Packet;
 
 typedef struct {
     i32 fd;
     const char* dst;
     char ip[INET_ADDRSTRLEN];
-    char host[NI_MAXHOST];
     struct sockaddr_in addr;
+    u16 seq;
+    u8 bits_duplicate[DUP_TABLE_SIZE];
+    struct timeval sent[DUP_TABLE_SIZE * 8];
 } PingData;
 
 typedef struct {
@@ -43,17 +63,44 @@ typedef struct {
     bool no_dns;
     bool ttl;
     bool timeout;
+    bool icmp_timestamp;
+    bool dashboard;
+    bool self_profile;
+    bool one_shot;
+    bool adaptive_timeout;
+    bool deadline;
+    bool stream;
     i32 ttl_value;
     i32 timeout_value;
     i32 waittime_value;
+    i32 deadline_value;
+    i32 stream_window;
+    i32 rate_value;
+    i32 interval_value;
+    i32 adaptive_value;
+    i32 retries_value;
+    IpOptKind ip_options;
+    const char* store_path;
+    const char* export_path;
+    const char* checkpoint_path;
+    const char* push_dest;
+    const char* peers;
 } Options;
 
 typedef struct {
     u32 pkt_transmitted;
     u32 pkt_received;
     u32 pkt_duplicate;
+    u32 retries;
+    u32 retry_received;
     f64 sum_rtt;
     f64 sumsq_rtt;
     f64 min_rtt;
     f64 max_rtt;
+    u32 ts_received;
+    i32 min_fwd;
+    i32 min_rev;
+    f64 sum_fwd;
+    f64 sum_rev;
+    Histogram hist;
 } Stats;
@@ -0,0 +1,29 @@
+#pragma once
+
+// USDT tracepoints under the "ft_ping" provider, e.g. for bpftrace:
+//   bpftrace -e 'usdt:./ft_ping:ft_ping:reply { printf("%s %d %d\n", str(arg0), arg1, arg2); }'
+// With <sys/sdt.h> each probe compiles to a single nop plus an ELF note, so they stay in
+// release builds. Without it, or with -DFT_PING_NO_USDT, they compile to nothing.
+#if defined(__has_include) && !defined(FT_PING_NO_USDT)
+#if __has_include(<sys/sdt.h>)
+#define FT_PING_USDT 1
+#endif
+#endif
+
+#ifdef FT_PING_USDT
+#include <sys/sdt.h>
+
+#define PROBE_SEND(target, seq) DTRACE_PROBE2(ft_ping, send, target, seq)
+#define PROBE_REPLY(target, seq, rtt_ns) DTRACE_PROBE3(ft_ping, reply, target, seq, rtt_ns)
+#define PROBE_DUPLICATE(target, seq) DTRACE_PROBE2(ft_ping, duplicate, target, seq)
+#define PROBE_TIMEOUT(target, seq) DTRACE_PROBE2(ft_ping, timeout, target, seq)
+#define PROBE_STATS(target, transmitted, received, rtt_ns)                                        \
+    DTRACE_PROBE4(ft_ping, stats, target, transmitted, received, rtt_ns)
+#else
+#define PROBE_SEND(target, seq) ((void)(target), (void)(seq))
+#define PROBE_REPLY(target, seq, rtt_ns) ((void)(target), (void)(seq), (void)(rtt_ns))
+#define PROBE_DUPLICATE(target, seq) ((void)(target), (void)(seq))
+#define PROBE_TIMEOUT(target, seq) ((void)(target), (void)(seq))
+#define PROBE_STATS(target, transmitted, received, rtt_ns)                                        \
+    ((void)(target), (void)(transmitted), (void)(received), (void)(rtt_ns))
+#endif
@@ -0,0 +1,98 @@
+#include "push.h"
+
+#include <arpa/inet.h>
+#include <netdb.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+// "host:port" is sent over udp, anything else is a unix datagram socket path
+bool
+push_resolve(const char* dest, PushAddr* out) {
+    memset(out, 0, sizeof(*out));
+
+    const char* colon = strrchr(dest, ':');
+    if (colon == NULL || strchr(dest, '/') != NULL) {
+        struct sockaddr_un* addr = (struct sockaddr_un*)&out->addr;
+        if (strlen(dest) >= sizeof(addr->sun_path)) return false;
+
+        addr->sun_family = AF_UNIX;
+        strcpy(addr->sun_path, dest);
+        out->addr_len = sizeof(*addr);
+        return true;
+    }
+
+    char host[NI_MAXHOST];
+    const u64 host_len = colon - dest;
+    if (host_len >= sizeof(host)) return false;
+    memcpy(host, dest, host_len);
+    host[host_len] = 0;
+
+    const struct addrinfo hints = {
+        .ai_family = AF_INET,
+        .ai_socktype = SOCK_DGRAM,
+    };
+    struct addrinfo* result = NULL;
+    if (getaddrinfo(host, colon + 1, &hints, &result) != 0) return false;
+
+    memcpy(&out->addr, result->ai_addr, result->ai_addrlen);
+    out->addr_len = result->ai_addrlen;
+    freeaddrinfo(result);
+
+    return true;
+}
+
+bool
+push_open(Pusher* pusher, const char* dest) {
+    memset(pusher, 0, sizeof(*pusher));
+    pusher->source = (u32)gethostid() * 31 + getpid();
+
+    if (!push_resolve(dest, &pusher->dst)) return false;
+
+    pusher->fd = socket(pusher->dst.addr.ss_family, SOCK_DGRAM, 0);
+    return pusher->fd >= 0;
+}
+
+bool
+push_stats(Pusher* pusher, const Stats* stats) {
+    u8 buffer[PUSH_MAX_SIZE];
+    PushHeader* header = (PushHeader*)buffer;
+    PushBucket* buckets = (PushBucket*)(header + 1);
+
+    u32 count = 0;
+    for (u32 i = 0; i < HIST_BUCKETS; i++) {
+        const u32 delta = stats->hist.buckets[i] - pusher->sent.hist.buckets[i];
+        if (delta == 0) continue;
+
+        buckets[count].index = htonl(i);
+        buckets[count].count = htonl(delta);
+        count++;
+    }
+
+    *header = (PushHeader){
+        .magic = htonl(PUSH_MAGIC),
+        .kind = htonl(Push_Delta),
+        .source = htonl(pusher->source),
+        .transmitted = htonl(stats->pkt_transmitted - pusher->sent.pkt_transmitted),
+        .received = htonl(stats->pkt_received - pusher->sent.pkt_received),
+        .duplicate = htonl(stats->pkt_duplicate - pusher->sent.pkt_duplicate),
+        .bucket_count = htonl(count),
+    };
+
+    const u64 size = sizeof(*header) + count * sizeof(PushBucket);
+    const ssize_t res = sendto(
+        pusher->fd,
+        buffer,
+        size,
+        0,
+        (struct sockaddr*)&pusher->dst.addr,
+        pusher->dst.addr_len
+    );
+
+    // on failure the delta keeps growing and goes out with the next push
+    if (res != (ssize_t)size) return false;
+
+    pusher->sent = *stats;
+    return true;
+}
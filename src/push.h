@@ -0,0 +1,55 @@
+#pragma once
+
+#include "ping.h"
+#include "types.h"
+
+#include <stdbool.h>
+#include <sys/socket.h>
+
+#define PUSH_MAGIC 0x48505446u // "FTPH"
+#define PUSH_INTERVAL_PROBES 10
+#define PUSH_MAX_SIZE (sizeof(PushHeader) + HIST_BUCKETS * sizeof(PushBucket))
+
+typedef enum {
+    Push_Delta = 0,
+    Push_Query = 1,
+} PushKind;
+
+// Stats deltas since the previous push, in network byte order. Only non-empty histogram
+// buckets are sent, as (index, count) pairs following the header. Deltas of fixed-layout
+// histograms can be added by the aggregator, which keeps its percentiles exact.
+typedef struct {
+    u32 magic;
+    u32 kind;
+    u32 source;
+    u32 transmitted;
+    u32 received;
+    u32 duplicate;
+    u32 bucket_count;
+} PushHeader;
+
+typedef struct {
+    u32 index;
+    u32 count;
+} PushBucket;
+
+typedef struct {
+    struct sockaddr_storage addr;
+    socklen_t addr_len;
+} PushAddr;
+
+typedef struct {
+    i32 fd;
+    u32 source;
+    PushAddr dst;
+    Stats sent;
+} Pusher;
+
+bool
+push_resolve(const char* dest, PushAddr* out);
+
+bool
+push_open(Pusher* pusher, const char* dest);
+
+bool
+push_stats(Pusher* pusher, const Stats* stats);
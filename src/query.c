@@ -0,0 +1,70 @@
+#include "store.h"
+#include "types.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+static const char* progname = NULL;
+
+static void
+usage(void) {
+    dprintf(STDERR_FILENO, "usage: %s <store> [from] [to]\n\n", progname);
+    dprintf(STDERR_FILENO, "  %-20s%s\n", "<store>", "file written by ft_ping -o");
+    dprintf(STDERR_FILENO, "  %-20s%s\n", "[from] [to]", "time range in unix seconds");
+}
+
+static void
+fail(const char* what) {
+    const char* err = strerror(errno);
+    dprintf(STDERR_FILENO, "%s: %s: %s\n", progname, what, err);
+    exit(EXIT_FAILURE);
+}
+
+int
+main(int argc, const char* const* argv) {
+    progname = argc > 0 ? argv[0] : "ft_ping_query";
+
+    if (argc < 2 || argc > 4) {
+        usage();
+        exit(EXIT_FAILURE);
+    }
+
+    const u64 from = argc > 2 ? strtoull(argv[2], NULL, 10) * 1000000 : 0;
+    const u64 to = argc > 3 ? strtoull(argv[3], NULL, 10) * 1000000 : UINT64_MAX;
+
+    const i32 fd = open(argv[1], O_RDONLY);
+    if (fd < 0) fail(argv[1]);
+
+    struct stat st;
+    if (fstat(fd, &st) != 0) fail(argv[1]);
+    if (st.st_size == 0) return EXIT_SUCCESS;
+
+    const u8* data = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    if (data == MAP_FAILED) fail(argv[1]);
+
+    StoreIter iter;
+    store_iter_init(&iter, data, st.st_size, from);
+
+    u64 ts;
+    f64 rtt;
+    while (store_iter_next(&iter, &ts, &rtt)) {
+        if (ts < from) continue;
+        if (ts >= to) break;
+
+        if (isnan(rtt)) {
+            printf("%lu.%06lu timeout\n", ts / 1000000, ts % 1000000);
+        } else {
+            printf("%lu.%06lu %.3f\n", ts / 1000000, ts % 1000000, rtt);
+        }
+    }
+
+    munmap((void*)data, st.st_size);
+    close(fd);
+}
@@ -0,0 +1,260 @@
+#include "store.h"
+
+#include <fcntl.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#define DATA_OFFSET sizeof(SegmentHeader)
+#define DATA_BITS ((STORE_SEGMENT_SIZE - DATA_OFFSET) * 8)
+#define MAX_SAMPLE_BITS 160
+#define NO_WINDOW 0xff
+
+static void
+put_bits(u8* data, u64* pos, const u64 value, u32 n) {
+    while (n > 0) {
+        const u32 room = 8 - (*pos & 7);
+        const u32 take = n < room ? n : room;
+        const u8 chunk = (value >> (n - take)) & ((1u << take) - 1);
+        data[*pos >> 3] |= chunk << (room - take);
+        *pos += take;
+        n -= take;
+    }
+}
+
+static u64
+get_bits(const u8* data, u64* pos, u32 n) {
+    u64 out = 0;
+    while (n > 0) {
+        const u32 room = 8 - (*pos & 7);
+        const u32 take = n < room ? n : room;
+        const u8 chunk = (data[*pos >> 3] >> (room - take)) & ((1u << take) - 1);
+        out = (out << take) | chunk;
+        *pos += take;
+        n -= take;
+    }
+    return out;
+}
+
+static bool
+fits(const i64 value, const u32 bits) {
+    const i64 limit = 1ll << (bits - 1);
+    return value >= -limit && value < limit;
+}
+
+static i64
+sign_extend(const u64 value, const u32 bits) {
+    const u64 sign = 1ull << (bits - 1);
+    return (i64)((value ^ sign) - sign);
+}
+
+static void
+put_dod(u8* data, u64* pos, const i64 dod) {
+    if (dod == 0) {
+        put_bits(data, pos, 0x0, 1);
+    } else if (fits(dod, 7)) {
+        put_bits(data, pos, 0x2, 2);
+        put_bits(data, pos, dod & 0x7f, 7);
+    } else if (fits(dod, 12)) {
+        put_bits(data, pos, 0x6, 3);
+        put_bits(data, pos, dod & 0xfff, 12);
+    } else if (fits(dod, 20)) {
+        put_bits(data, pos, 0xe, 4);
+        put_bits(data, pos, dod & 0xfffff, 20);
+    } else {
+        put_bits(data, pos, 0xf, 4);
+        put_bits(data, pos, dod, 64);
+    }
+}
+
+static i64
+get_dod(const u8* data, u64* pos) {
+    if (get_bits(data, pos, 1) == 0) return 0;
+    if (get_bits(data, pos, 1) == 0) return sign_extend(get_bits(data, pos, 7), 7);
+    if (get_bits(data, pos, 1) == 0) return sign_extend(get_bits(data, pos, 12), 12);
+    if (get_bits(data, pos, 1) == 0) return sign_extend(get_bits(data, pos, 20), 20);
+    return get_bits(data, pos, 64);
+}
+
+static void
+put_value(u8* data, u64* pos, const u64 x, u8* leading, u8* trailing) {
+    if (x == 0) {
+        put_bits(data, pos, 0, 1);
+        return;
+    }
+    put_bits(data, pos, 1, 1);
+
+    u32 lead = __builtin_clzll(x);
+    const u32 trail = __builtin_ctzll(x);
+    if (lead > 31) lead = 31;
+
+    if (*leading != NO_WINDOW && lead >= *leading && trail >= *trailing) {
+        put_bits(data, pos, 0, 1);
+        put_bits(data, pos, x >> *trailing, 64 - *leading - *trailing);
+    } else {
+        const u32 len = 64 - lead - trail;
+        put_bits(data, pos, 1, 1);
+        put_bits(data, pos, lead, 5);
+        put_bits(data, pos, len - 1, 6);
+        put_bits(data, pos, x >> trail, len);
+        *leading = lead;
+        *trailing = trail;
+    }
+}
+
+static u64
+get_value(const u8* data, u64* pos, u8* leading, u8* trailing) {
+    if (get_bits(data, pos, 1) == 0) return 0;
+
+    if (get_bits(data, pos, 1) == 1) {
+        *leading = get_bits(data, pos, 5);
+        const u32 len = get_bits(data, pos, 6) + 1;
+        *trailing = 64 - *leading - len;
+    }
+    return get_bits(data, pos, 64 - *leading - *trailing) << *trailing;
+}
+
+static bool
+map_segment(Store* store) {
+    void* ptr = mmap(
+        NULL,
+        STORE_SEGMENT_SIZE,
+        PROT_READ | PROT_WRITE,
+        MAP_SHARED,
+        store->fd,
+        store->offset
+    );
+    if (ptr == MAP_FAILED) return false;
+
+    store->segment = ptr;
+    return true;
+}
+
+static bool
+new_segment(Store* store, const u64 offset) {
+    if (store->segment != NULL) {
+        munmap(store->segment, STORE_SEGMENT_SIZE);
+        store->segment = NULL;
+    }
+
+    if (ftruncate(store->fd, offset + STORE_SEGMENT_SIZE) != 0) return false;
+
+    store->offset = offset;
+    if (!map_segment(store)) return false;
+
+    store->segment->magic = STORE_MAGIC;
+    store->segment->last_leading = NO_WINDOW;
+    return true;
+}
+
+bool
+store_open(Store* store, const char* path) {
+    *store = (Store){ .fd = open(path, O_RDWR | O_CREAT, 0644) };
+    if (store->fd < 0) return false;
+
+    struct stat st;
+    if (fstat(store->fd, &st) != 0) return false;
+
+    const u64 size = st.st_size - st.st_size % STORE_SEGMENT_SIZE;
+    if (size == 0) return new_segment(store, 0);
+
+    store->offset = size - STORE_SEGMENT_SIZE;
+    if (!map_segment(store)) return false;
+
+    if (store->segment->magic != STORE_MAGIC) return new_segment(store, size);
+    return true;
+}
+
+bool
+store_append(Store* store, const u64 ts_us, const f64 rtt) {
+    SegmentHeader* seg = store->segment;
+    if (seg->bits + MAX_SAMPLE_BITS > DATA_BITS) {
+        if (!new_segment(store, store->offset + STORE_SEGMENT_SIZE)) return false;
+        seg = store->segment;
+    }
+
+    u8* data = (u8*)seg + DATA_OFFSET;
+    u64 pos = seg->bits;
+
+    u64 value;
+    memcpy(&value, &rtt, sizeof(value));
+
+    if (seg->count == 0) {
+        put_bits(data, &pos, ts_us, 64);
+        put_bits(data, &pos, value, 64);
+        seg->first_ts = ts_us;
+    } else {
+        const i64 delta = ts_us - seg->last_ts;
+        put_dod(data, &pos, delta - seg->last_delta);
+        put_value(data, &pos, value ^ seg->last_value, &seg->last_leading, &seg->last_trailing);
+        seg->last_delta = delta;
+    }
+
+    seg->last_ts = ts_us;
+    seg->last_value = value;
+    seg->bits = pos;
+    seg->count++;
+
+    return true;
+}
+
+void
+store_close(Store* store) {
+    if (store->segment != NULL) {
+        msync(store->segment, STORE_SEGMENT_SIZE, MS_SYNC);
+        munmap(store->segment, STORE_SEGMENT_SIZE);
+    }
+    if (store->fd >= 0) close(store->fd);
+    *store = (Store){ .fd = -1 };
+}
+
+static bool
+next_segment(StoreIter* iter, const u64 from_us) {
+    while (iter->offset + STORE_SEGMENT_SIZE <= iter->size) {
+        const SegmentHeader* seg = (const SegmentHeader*)(iter->data + iter->offset);
+        iter->offset += STORE_SEGMENT_SIZE;
+
+        if (seg->magic != STORE_MAGIC || seg->count == 0) continue;
+        if (seg->last_ts < from_us) continue;
+
+        iter->segment = seg;
+        iter->index = 0;
+        iter->pos = 0;
+        iter->leading = NO_WINDOW;
+        return true;
+    }
+
+    iter->segment = NULL;
+    return false;
+}
+
+void
+store_iter_init(StoreIter* iter, const u8* data, const u64 size, const u64 from_us) {
+    *iter = (StoreIter){ .data = data, .size = size };
+    next_segment(iter, from_us);
+}
+
+bool
+store_iter_next(StoreIter* iter, u64* ts_us, f64* rtt) {
+    while (iter->segment != NULL && iter->index >= iter->segment->count) {
+        next_segment(iter, 0);
+    }
+    if (iter->segment == NULL) return false;
+
+    const u8* data = (const u8*)iter->segment + DATA_OFFSET;
+    if (iter->index == 0) {
+        iter->ts = get_bits(data, &iter->pos, 64);
+        iter->value = get_bits(data, &iter->pos, 64);
+        iter->delta = 0;
+    } else {
+        iter->delta += get_dod(data, &iter->pos);
+        iter->ts += iter->delta;
+        iter->value ^= get_value(data, &iter->pos, &iter->leading, &iter->trailing);
+    }
+    iter->index++;
+
+    *ts_us = iter->ts;
+    memcpy(rtt, &iter->value, sizeof(*rtt));
+    return true;
+}
@@ -0,0 +1,59 @@
+#pragma once
+
+#include "types.h"
+
+#include <stdbool.h>
+
+#define STORE_MAGIC 0x53505446u // "FTPS"
+#define STORE_SEGMENT_SIZE (1 << 20)
+
+// Append-only RTT sample store. The file is a sequence of fixed-size segments, each one a
+// Gorilla-style compressed block: timestamps are encoded as delta-of-delta and rtt values as
+// the xor with the previous value. The header carries the encoder state so a segment can be
+// resumed after a restart, and the first/last timestamps so queries can skip whole segments.
+typedef struct {
+    u32 magic;
+    u32 count;
+    u64 bits;
+    u64 first_ts;
+    u64 last_ts;
+    i64 last_delta;
+    u64 last_value;
+    u8 last_leading;
+    u8 last_trailing;
+} SegmentHeader;
+
+typedef struct {
+    i32 fd;
+    u64 offset;
+    SegmentHeader* segment;
+} Store;
+
+typedef struct {
+    const u8* data;
+    u64 size;
+    u64 offset;
+    const SegmentHeader* segment;
+    u32 index;
+    u64 pos;
+    u64 ts;
+    i64 delta;
+    u64 value;
+    u8 leading;
+    u8 trailing;
+} StoreIter;
+
+bool
+store_open(Store* store, const char* path);
+
+bool
+store_append(Store* store, const u64 ts_us, const f64 rtt);
+
+void
+store_close(Store* store);
+
+void
+store_iter_init(StoreIter* iter, const u8* data, const u64 size, const u64 from_us);
+
+bool
+store_iter_next(StoreIter* iter, u64* ts_us, f64* rtt);
@@ -0,0 +1,375 @@
+#define _GNU_SOURCE // recvmmsg
+
+#include "stream.h"
+#include "line.h"
+#include "ping.h"
+#include "utils.h"
+
+#include <arpa/inet.h>
+#include <errno.h>
+#include <netdb.h>
+#include <poll.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+typedef struct {
+    i32 fd;
+    u16 pid;
+    u32 window;
+    u32 slot_bits;
+    u32 slot_count;
+    u32 in_flight;
+    u64 waittime_us;
+    u64 send_interval_us;
+    u64 next_send_us;
+    StreamSlot* slots;
+    char input[STREAM_INPUT_SIZE];
+    u32 input_len;
+    bool eof;
+} Stream;
+
+static void
+report(const StreamSlot* slot, const char* result) {
+    char ip[INET_ADDRSTRLEN];
+    inet_ntop(AF_INET, &slot->addr.sin_addr, ip, sizeof(ip));
+
+    Line line = { 0 };
+    line_str(&line, slot->target);
+    line_str(&line, " ");
+    line_str(&line, ip);
+    line_str(&line, " ");
+    line_str(&line, result);
+    line_str(&line, "\n");
+    line_flush(&line);
+}
+
+static void
+finish(Stream* stream, StreamSlot* slot, const char* result) {
+    report(slot, result);
+    slot->busy = false;
+    stream->in_flight--;
+}
+
+static bool
+resolve(const char* target, struct sockaddr_in* out) {
+    *out = (struct sockaddr_in){ .sin_family = AF_INET };
+    if (inet_pton(AF_INET, target, &out->sin_addr) == 1) return true;
+
+    const struct addrinfo hints = {
+        .ai_family = AF_INET,
+        .ai_socktype = SOCK_RAW,
+        .ai_protocol = IPPROTO_ICMP,
+    };
+    struct addrinfo* result = NULL;
+    if (getaddrinfo(target, NULL, &hints, &result) != 0) return false;
+
+    *out = *(struct sockaddr_in*)result->ai_addr;
+    freeaddrinfo(result);
+    return true;
+}
+
+static void
+start_probe(Stream* stream, const char* target) {
+    u32 index = 0;
+    while (stream->slots[index].busy) index++;
+    StreamSlot* slot = &stream->slots[index];
+
+    const u32 len = strlen(target);
+    if (len >= STREAM_TARGET_SIZE || !resolve(target, &slot->addr)) {
+        printf("%s unknown\n", target);
+        return;
+    }
+    memcpy(slot->target, target, len + 1);
+
+    // the low bits of the sequence are the slot index, so a reply finds its slot directly
+    slot->seq = (slot->generation++ << stream->slot_bits) | index;
+
+    Packet pkt = {
+        .header = {
+            .type = Icmp_EchoRequest,
+            .id = stream->pid,
+            .seq = htons(slot->seq),
+        },
+    };
+    for (u32 i = 0; i < sizeof(pkt.msg); i++) {
+        pkt.msg[i] = i + '0';
+    }
+    pkt.header.cksum = checksum(&pkt, sizeof(pkt));
+
+    gettimeofday(&slot->sent, NULL);
+    const ssize_t res = sendto(
+        stream->fd,
+        &pkt,
+        PKTSIZE,
+        0,
+        (struct sockaddr*)&slot->addr,
+        sizeof(slot->addr)
+    );
+
+    slot->busy = true;
+    stream->in_flight++;
+    if (res < 0) finish(stream, slot, strerror(errno));
+}
+
+static u64
+now_us(void) {
+    struct timeval now;
+    gettimeofday(&now, NULL);
+    return to_us(now);
+}
+
+// consumes complete lines while the window has room and the rate cap allows another send,
+// the rest waits in the input buffer. Returns the poll timeout until the next send slot.
+static i32
+take_targets(Stream* stream) {
+    u32 begin = 0;
+    i32 timeout = -1;
+    while (stream->in_flight < stream->window) {
+        char* end = memchr(stream->input + begin, '\n', stream->input_len - begin);
+        if (end == NULL) break;
+
+        if (stream->send_interval_us > 0) {
+            const u64 now = now_us();
+            if (now < stream->next_send_us) {
+                timeout = (stream->next_send_us - now) / 1000 + 1;
+                break;
+            }
+        }
+
+        *end = 0;
+        const char* target = stream->input + begin;
+        begin = end - stream->input + 1;
+
+        while (is_space(*target)) target++;
+        if (*target == 0) continue;
+
+        start_probe(stream, target);
+        if (stream->send_interval_us > 0) {
+            const u64 now = now_us();
+            const u64 from = stream->next_send_us > now ? stream->next_send_us : now;
+            stream->next_send_us = from + stream->send_interval_us;
+        }
+    }
+
+    memmove(stream->input, stream->input + begin, stream->input_len - begin);
+    stream->input_len -= begin;
+    return timeout;
+}
+
+static void
+read_targets(Stream* stream) {
+    const ssize_t bytes = read(
+        STDIN_FILENO,
+        stream->input + stream->input_len,
+        STREAM_INPUT_SIZE - 1 - stream->input_len
+    );
+
+    if (bytes <= 0) {
+        // a last target without a trailing newline
+        stream->eof = true;
+        stream->input[stream->input_len++] = '\n';
+    } else {
+        stream->input_len += bytes;
+    }
+
+    // a full buffer without a single line in it is not a target
+    if (stream->input_len == STREAM_INPUT_SIZE - 1) {
+        if (memchr(stream->input, '\n', stream->input_len) == NULL) stream->input_len = 0;
+    }
+}
+
+typedef struct {
+    StreamSlot* slot;
+    struct in_addr addr;
+    u16 seq;
+    u32 index;
+    const char* result;
+} StreamReply;
+
+// maps a datagram to the slot of the probe it answers or quotes; result is NULL for echo replies
+static bool
+decode_reply(Stream* stream, const u8* buffer, const u64 bytes, StreamReply* out) {
+    const struct ip* ip = (const struct ip*)buffer;
+    const u32 header_size = ip->ip_hl << 2;
+    if (bytes < header_size + MIN_ICMPSIZE) return false;
+
+    const IcmpEchoHeader* hdr = (const IcmpEchoHeader*)(buffer + header_size);
+    if (hdr->type == Icmp_EchoReply) {
+        if (hdr->id != stream->pid) return false;
+
+        out->addr = ip->ip_src;
+        out->seq = ntohs(hdr->seq);
+        out->result = NULL;
+    } else {
+        // errors quote our request, match it by its destination and sequence
+        const u64 inner_offset = header_size + MIN_ICMPSIZE;
+        if (bytes < inner_offset + sizeof(struct ip)) return false;
+
+        const struct ip* inner = (const struct ip*)(buffer + inner_offset);
+        const u64 inner_size = inner->ip_hl << 2;
+        if (inner->ip_p != IPPROTO_ICMP) return false;
+        if (bytes < inner_offset + inner_size + MIN_ICMPSIZE) return false;
+
+        const IcmpEchoHeader* probe = (const IcmpEchoHeader*)(buffer + inner_offset + inner_size);
+        if (probe->type != Icmp_EchoRequest || probe->id != stream->pid) return false;
+
+        out->addr = inner->ip_dst;
+        out->seq = ntohs(probe->seq);
+        out->result = hdr->type == Icmp_TimeExceeded ? "ttl exceeded" : "unreachable";
+    }
+
+    out->slot = &stream->slots[out->seq & (stream->slot_count - 1)];
+    return true;
+}
+
+static struct timeval
+packet_time(struct msghdr* msg, const struct timeval fallback) {
+    for (struct cmsghdr* cmsg = CMSG_FIRSTHDR(msg); cmsg; cmsg = CMSG_NXTHDR(msg, cmsg)) {
+        if (cmsg->cmsg_level == SOL_SOCKET && cmsg->cmsg_type == SO_TIMESTAMP) {
+            struct timeval out;
+            memcpy(&out, CMSG_DATA(cmsg), sizeof(out));
+            return out;
+        }
+    }
+    return fallback;
+}
+
+// One recvmmsg worth of datagrams, run stage by stage over the whole batch: decoding all of
+// them first lets the slot of every reply be prefetched before the completion stage reads it.
+// Returns whether the batch was full and the socket may hold more.
+static bool
+receive_batch(Stream* stream) {
+    u8 buffers[STREAM_BATCH][256];
+    u8 controls[STREAM_BATCH][CMSG_SPACE(sizeof(struct timeval))];
+    struct iovec iov[STREAM_BATCH];
+    struct mmsghdr msgs[STREAM_BATCH];
+
+    for (u32 i = 0; i < STREAM_BATCH; i++) {
+        iov[i] = (struct iovec){ .iov_base = buffers[i], .iov_len = sizeof(buffers[i]) };
+        msgs[i] = (struct mmsghdr){
+            .msg_hdr = {
+                .msg_iov = &iov[i],
+                .msg_iovlen = 1,
+                .msg_control = controls[i],
+                .msg_controllen = sizeof(controls[i]),
+            },
+        };
+    }
+
+    const i32 count = recvmmsg(stream->fd, msgs, STREAM_BATCH, MSG_DONTWAIT, NULL);
+    if (count <= 0) return false;
+
+    struct timeval now;
+    gettimeofday(&now, NULL);
+
+    StreamReply replies[STREAM_BATCH];
+    u32 reply_count = 0;
+    for (i32 i = 0; i < count; i++) {
+        StreamReply* reply = &replies[reply_count];
+        if (!decode_reply(stream, buffers[i], msgs[i].msg_len, reply)) continue;
+
+        __builtin_prefetch(reply->slot);
+        reply->index = i;
+        reply_count++;
+    }
+
+    for (u32 i = 0; i < reply_count; i++) {
+        const StreamReply* reply = &replies[i];
+        StreamSlot* slot = reply->slot;
+        if (!slot->busy || slot->seq != reply->seq) continue;
+        if (slot->addr.sin_addr.s_addr != reply->addr.s_addr) continue;
+
+        if (reply->result != NULL) {
+            finish(stream, slot, reply->result);
+            continue;
+        }
+
+        char rtt[32];
+        const struct timeval end = packet_time(&msgs[reply->index].msg_hdr, now);
+        snprintf(rtt, sizeof(rtt), "%.3f", to_ms(time_diff(end, slot->sent)));
+        finish(stream, slot, rtt);
+    }
+
+    return count == STREAM_BATCH;
+}
+
+// expires probes past the wait time, returns the poll timeout until the next one expires
+static i32
+expire_probes(Stream* stream) {
+    struct timeval now;
+    gettimeofday(&now, NULL);
+
+    i64 next_us = -1;
+    for (u32 i = 0; i < stream->slot_count; i++) {
+        StreamSlot* slot = &stream->slots[i];
+        if (!slot->busy) continue;
+
+        const struct timeval elapsed = time_diff(now, slot->sent);
+        const i64 left_us =
+            (i64)stream->waittime_us - (elapsed.tv_sec * 1000000 + elapsed.tv_usec);
+        if (left_us <= 0) {
+            finish(stream, slot, "timeout");
+        } else if (next_us < 0 || left_us < next_us) {
+            next_us = left_us;
+        }
+    }
+
+    return next_us < 0 ? -1 : next_us / 1000 + 1;
+}
+
+static i32
+earliest(const i32 a, const i32 b) {
+    if (a < 0) return b;
+    if (b < 0) return a;
+    return a < b ? a : b;
+}
+
+bool
+stream_targets(
+    const i32 fd,
+    const u32 window,
+    const u32 waittime,
+    const u32 max_pps
+) {
+    Stream stream = {
+        .fd = fd,
+        .pid = getpid(),
+        .window = window,
+        .waittime_us = (u64)waittime * 1000000,
+        .send_interval_us = max_pps > 0 ? 1000000 / max_pps : 0,
+    };
+    while ((1u << stream.slot_bits) < window) stream.slot_bits++;
+    stream.slot_count = 1u << stream.slot_bits;
+
+    stream.slots = calloc(stream.slot_count, sizeof(StreamSlot));
+    if (stream.slots == NULL) return false;
+
+    while (!stream.eof || stream.in_flight > 0 || stream.input_len > 0) {
+        const i32 send_timeout = take_targets(&stream);
+        fflush(stdout);
+
+        const i32 expire_timeout = expire_probes(&stream);
+        const i32 timeout = earliest(send_timeout, expire_timeout);
+        const bool want_input = !stream.eof && stream.in_flight < stream.window
+                             && stream.input_len < STREAM_INPUT_SIZE - 1;
+        if (stream.eof && stream.in_flight == 0 && stream.input_len == 0) break;
+
+        struct pollfd fds[2] = {
+            { .fd = fd, .events = POLLIN },
+            { .fd = STDIN_FILENO, .events = POLLIN },
+        };
+        if (poll(fds, want_input ? 2 : 1, timeout) < 0 && errno != EINTR) break;
+
+        if (fds[0].revents & POLLIN) {
+            while (receive_batch(&stream)) continue;
+        }
+        if (want_input && fds[1].revents & (POLLIN | POLLHUP)) read_targets(&stream);
+    }
+
+    fflush(stdout);
+    free(stream.slots);
+    return true;
+}
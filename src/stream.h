@@ -0,0 +1,34 @@
+#pragma once
+
+#include "types.h"
+
+#include <netinet/in.h>
+#include <stdbool.h>
+#include <sys/time.h>
+
+#define STREAM_MAX_WINDOW 1024 // a power of two, sequence numbers carry the slot index
+#define STREAM_TARGET_SIZE 256
+#define STREAM_INPUT_SIZE 4096
+#define STREAM_BATCH 32
+
+typedef struct {
+    bool busy;
+    u16 seq;
+    u16 generation;
+    char target[STREAM_TARGET_SIZE];
+    struct sockaddr_in addr;
+    struct timeval sent;
+} StreamSlot;
+
+// Reads one target per line from stdin and probes each once, keeping at most `window` probes
+// in flight and sending at most `max_pps` per second when it is not zero. Stdin is not read
+// while the window is full, so memory stays at the window plus one input buffer however long
+// the input is. One line per target is written on completion: "<target> <ip> <rtt ms>",
+// "<target> <ip> timeout|unreachable|ttl exceeded" or "<target> unknown".
+bool
+stream_targets(
+    const i32 fd,
+    const u32 window,
+    const u32 waittime,
+    const u32 max_pps
+);
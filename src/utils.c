@@ -1,5 +1,28 @@
 #include "utils.h"
 
+#define SEC_PER_DAY 86400
+#define MS_PER_DAY (SEC_PER_DAY * 1000)
+
+u16
+checksum(const void* data, u64 len) {
+    u32 sum = 0;
+
+    const u16* ptr;
+    for (ptr = data; len > 1; len -= 2) {
+        sum += *ptr;
+        ptr++;
+    }
+
+    if (len == 1) {
+        sum += *(const u8*)ptr;
+    }
+
+    sum = (sum >> 16) + (sum & 0xFFFF);
+    sum += (sum >> 16);
+
+    return ~sum;
+}
+
 struct timeval
 time_diff(struct timeval a, struct timeval b) {
     struct timeval out = a;
@@ -21,6 +44,24 @@ to_ms(struct timeval t) {
     return out / 1000.0f;
 }
 
+u64
+to_us(struct timeval t) {
+    return t.tv_usec + (u64)t.tv_sec * 1000000;
+}
+
+u32
+ms_since_midnight(struct timeval t) {
+    return (t.tv_sec % SEC_PER_DAY) * 1000 + t.tv_usec / 1000;
+}
+
+i32
+ms_diff(const u32 a, const u32 b) {
+    i32 out = (i32)(a - b) % MS_PER_DAY;
+    if (out >= MS_PER_DAY / 2) out -= MS_PER_DAY;
+    if (out < -MS_PER_DAY / 2) out += MS_PER_DAY;
+    return out;
+}
+
 bool
 is_digit(const char c) {
     return c >= '0' && c <= '9';
@@ -5,12 +5,24 @@
 #include <stdbool.h>
 #include <sys/time.h>
 
+u16
+checksum(const void* data, u64 len);
+
 struct timeval
 time_diff(struct timeval a, struct timeval b);
 
 f64
 to_ms(struct timeval t);
 
+u64
+to_us(struct timeval t);
+
+u32
+ms_since_midnight(struct timeval t);
+
+i32
+ms_diff(const u32 a, const u32 b);
+
 bool
 is_digit(const char c);
 